@@ -6,9 +6,14 @@
 #include "windows.h"
 #include "libloaderapi.h"
 #include "shlwapi.h"
+#else
+#include <unistd.h>
 #endif // WIN32
+#include <cstring>
 #include <sstream>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #ifdef WIN32
 #define PATH_LENGTH MAX_PATH
@@ -39,6 +44,24 @@
 #define LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME LimitTrackingToWithinBounds
 #define LEAP_CAMERA_MODE TrackingMode
 #define HANDEDNESS Handedness
+#define MOUSE_BACKEND_NAME MouseBackend
+#define POLL_STRATEGY_NAME PollStrategy
+#define POLL_TIMEOUT_NAME PollTimeoutMs
+#define POLL_SPIN_TIME_NAME PollSpinMicroseconds
+#define RECORDING_PATH_NAME RecordingPath
+#define RECORDING_CAPACITY_NAME RecordingCapacityFrames
+#define DISPLAY_REFRESH_RATE_NAME DisplayRefreshRate
+#define POSITION_FILTER_ACTIVE_NAME PositionFilterActive
+#define FILTER_MIN_CUTOFF_NAME FilterMinCutoffHz
+#define FILTER_BETA_NAME FilterBeta
+#define PREDICTION_LEAD_NAME PredictionLeadMs
+#define DEVICES_NAME Devices
+#define BIMANUAL_CURSOR_HAND_NAME BimanualCursorHand
+#define MONITORS_NAME Monitors
+#define SAMPLE_RATE_NAME SampleRate
+
+// Devices value that polls every connected device, each on its own thread
+#define ALL_DEVICES "all"
 
 #define STRINGIFY(x) #x
 #define STRINGIFY_HELPER(x) STRINGIFY(x)
@@ -79,7 +102,7 @@ namespace rjs=rapidjson;
     { \
         TOKENPASTE(name, _) = name; \
     } \
-    std::string TOKENPASTE(Get, name) () const \
+    const std::string& TOKENPASTE(Get, name) () const \
     { \
         return TOKENPASTE(name, _); \
     }
@@ -105,10 +128,31 @@ class ConfigReader {
     SETTERS_AND_GETTERS_BOOL(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME, false);
     SETTERS_AND_GETTERS_STRING(LEAP_CAMERA_MODE, "desktop");
     SETTERS_AND_GETTERS_STRING(HANDEDNESS, "both");
+    SETTERS_AND_GETTERS_STRING(MOUSE_BACKEND_NAME, "default");
+    SETTERS_AND_GETTERS_STRING(POLL_STRATEGY_NAME, "hybrid");
+    SETTERS_AND_GETTERS_FLOAT(POLL_TIMEOUT_NAME, 100.0f);
+    SETTERS_AND_GETTERS_FLOAT(POLL_SPIN_TIME_NAME, 200.0f);
+    SETTERS_AND_GETTERS_STRING(RECORDING_PATH_NAME, "");
+    SETTERS_AND_GETTERS_FLOAT(RECORDING_CAPACITY_NAME, 36000.0f);
+    SETTERS_AND_GETTERS_FLOAT(DISPLAY_REFRESH_RATE_NAME, 60.0f);
+    SETTERS_AND_GETTERS_BOOL(POSITION_FILTER_ACTIVE_NAME, false);
+    SETTERS_AND_GETTERS_FLOAT(FILTER_MIN_CUTOFF_NAME, 1.0f);
+    SETTERS_AND_GETTERS_FLOAT(FILTER_BETA_NAME, 0.02f);
+    SETTERS_AND_GETTERS_FLOAT(PREDICTION_LEAD_NAME, -1.0f);
+    // Empty for LeapC's default device, ALL_DEVICES, or a comma separated list of serial numbers
+    SETTERS_AND_GETTERS_STRING(DEVICES_NAME, "");
+    // With Handedness "bimanual", the hand that moves the cursor, "left" or "right". The other one clicks.
+    SETTERS_AND_GETTERS_STRING(BIMANUAL_CURSOR_HAND_NAME, "right");
+    // Comma separated monitor numbers (0 is the primary), one per device in Devices order, that
+    // absolute positions map onto. Devices without one, or with -1, use the whole screen.
+    SETTERS_AND_GETTERS_STRING(MONITORS_NAME, "");
+    // 0 handles every tracking frame as it arrives. Otherwise the hands are sampled this many
+    // times a second, or DisplayRefreshRate times if negative, in step with the display.
+    SETTERS_AND_GETTERS_FLOAT(SAMPLE_RATE_NAME, 0.0f);
 
     private:
     std::string config_file_name_;
-    rjs::Document d_;
+    bool loaded_ = false;
 
     public:
     ConfigReader(std::string config_file_name) :
@@ -117,19 +161,36 @@ class ConfigReader {
         init();
     }
 
-    ConfigReader()
+    ConfigReader() :
+    config_file_name_(DefaultFileName())
+    {
+        init();
+    }
+
+    ~ConfigReader() {}
+
+    // CONFIG_FILE_NAME next to the executable
+    static std::string DefaultFileName()
     {
         char configFilePath[PATH_LENGTH];
         getExecutableDirectory(configFilePath, PATH_LENGTH); 
         std::stringstream ss;
         ss << configFilePath << PATH_SEPARATOR << CONFIG_FILE_NAME;
-        config_file_name_ = ss.str();
-        init();
+        return ss.str();
     }
 
-    ~ConfigReader() {}
+    const std::string& GetFileName() const
+    {
+        return config_file_name_;
+    }
+
+    // "false" if the file couldn't be read or parsed, in which case everything is a default
+    bool Loaded() const
+    {
+        return loaded_;
+    }
 
-    void print()
+    void print() const
     {
         printf( STRINGIFY_HELPER(SPEED_NAME) ": %f\n", TOKENPASTE(SPEED_NAME, _));
         printf( STRINGIFY_HELPER(FIST_TO_LIFT_NAME) ": %s\n", TOKENPASTE(FIST_TO_LIFT_NAME, _) ? "true" : "false");
@@ -150,26 +211,45 @@ class ConfigReader {
         printf( STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME) ": %s\n", TOKENPASTE(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME, _) ? "true" : "false");
         printf( STRINGIFY_HELPER(LEAP_CAMERA_MODE) ": %s\n", TOKENPASTE(LEAP_CAMERA_MODE, _.c_str()));
         printf( STRINGIFY_HELPER(HANDEDNESS) ": %s\n", TOKENPASTE(HANDEDNESS, _.c_str()));
+        printf( STRINGIFY_HELPER(MOUSE_BACKEND_NAME) ": %s\n", TOKENPASTE(MOUSE_BACKEND_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(POLL_STRATEGY_NAME) ": %s\n", TOKENPASTE(POLL_STRATEGY_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(POLL_TIMEOUT_NAME) ": %f\n", TOKENPASTE(POLL_TIMEOUT_NAME, _));
+        printf( STRINGIFY_HELPER(POLL_SPIN_TIME_NAME) ": %f\n", TOKENPASTE(POLL_SPIN_TIME_NAME, _));
+        printf( STRINGIFY_HELPER(RECORDING_PATH_NAME) ": %s\n", TOKENPASTE(RECORDING_PATH_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(RECORDING_CAPACITY_NAME) ": %f\n", TOKENPASTE(RECORDING_CAPACITY_NAME, _));
+        printf( STRINGIFY_HELPER(DISPLAY_REFRESH_RATE_NAME) ": %f\n", TOKENPASTE(DISPLAY_REFRESH_RATE_NAME, _));
+        printf( STRINGIFY_HELPER(POSITION_FILTER_ACTIVE_NAME) ": %s\n", TOKENPASTE(POSITION_FILTER_ACTIVE_NAME, _) ? "true" : "false");
+        printf( STRINGIFY_HELPER(FILTER_MIN_CUTOFF_NAME) ": %f\n", TOKENPASTE(FILTER_MIN_CUTOFF_NAME, _));
+        printf( STRINGIFY_HELPER(FILTER_BETA_NAME) ": %f\n", TOKENPASTE(FILTER_BETA_NAME, _));
+        printf( STRINGIFY_HELPER(PREDICTION_LEAD_NAME) ": %f\n", TOKENPASTE(PREDICTION_LEAD_NAME, _));
+        printf( STRINGIFY_HELPER(DEVICES_NAME) ": %s\n", TOKENPASTE(DEVICES_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(BIMANUAL_CURSOR_HAND_NAME) ": %s\n", TOKENPASTE(BIMANUAL_CURSOR_HAND_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(MONITORS_NAME) ": %s\n", TOKENPASTE(MONITORS_NAME, _.c_str()));
+        printf( STRINGIFY_HELPER(SAMPLE_RATE_NAME) ": %f\n", TOKENPASTE(SAMPLE_RATE_NAME, _));
     }
 
     private:
     void init()
     {
         printf("Looking for config file at %s\n", config_file_name_.c_str());
-        std::ifstream ifs(config_file_name_);
+        std::ifstream ifs(config_file_name_, std::ios::binary);
 
         if (!ifs.fail())
         {
-            std::string line;
-            std::stringstream ss;
-            while (std::getline(ifs, line))
+            // Read in one go and parsed in place, the strings are copied out before it goes
+            std::vector<char> buffer((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            buffer.push_back('\0');
+
+            rjs::Document d;
+            d.ParseInsitu(buffer.data());
+            if (d.HasParseError() || !d.IsObject())
             {
-                ss << line;
+                printf("Error parsing config file, using defaults.\n");
+                return;
             }
 
-            d_.Parse(ss.str().c_str());
-
-            validateAndLoadJson(); 
+            validateAndLoadJson(d);
+            loaded_ = true;
         }
         else
         {
@@ -190,199 +270,366 @@ class ConfigReader {
     strncpy(dest, reinterpret_cast<const char*>(path), static_cast<size_t>(length));
 
     return static_cast<size_t>(length);
+#else
+    ssize_t length = readlink("/proc/self/exe", dest, destLength - 1);
+    if (length <= 0)
+    {
+        // Fall back to the working directory
+        strncpy(dest, ".", destLength);
+        return 1;
+    }
+    dest[length] = '\0';
+
+    // Strip the executable's name
+    char* lastSeparator = strrchr(dest, '/');
+    if (lastSeparator != nullptr)
+    {
+        *lastSeparator = '\0';
+    }
+    return strlen(dest);
 #endif // WIN32
     }
 
-    void validateAndLoadJson()
+    void validateAndLoadJson(const rjs::Document& d)
     {
-        if (d_.HasMember(STRINGIFY_HELPER(ORIENTATION_NAME )))
+        if (d.HasMember(STRINGIFY_HELPER(ORIENTATION_NAME )))
         {
-            // assert(d_[STRINGIFY_HELPER(ORIENTATION_NAME)].IsString());
-            TOKENPASTE(ORIENTATION_NAME, _) = d_[STRINGIFY_HELPER(ORIENTATION_NAME)].GetBool();
+            // assert(d[STRINGIFY_HELPER(ORIENTATION_NAME)].IsString());
+            TOKENPASTE(ORIENTATION_NAME, _) = d[STRINGIFY_HELPER(ORIENTATION_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(ORIENTATION_NAME) " not found!\n");
         }
         
-        if (d_.HasMember(STRINGIFY_HELPER(SPEED_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(SPEED_NAME)))
         {
-            // assert(d_[STRINGIFY(SPEED_NAME)].IsNumber());
-            TOKENPASTE(SPEED_NAME, _) = d_[STRINGIFY_HELPER(SPEED_NAME)].GetFloat();
+            // assert(d[STRINGIFY(SPEED_NAME)].IsNumber());
+            TOKENPASTE(SPEED_NAME, _) = d[STRINGIFY_HELPER(SPEED_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(SPEED_NAME) " not found!\n");
         }
         
-        if (d_.HasMember(STRINGIFY_HELPER(FIST_TO_LIFT_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(FIST_TO_LIFT_NAME)))
         {
-            // assert(d_[STRINGIFY(SCROLLING_SPEED_NAME)].IsFloat());
-            TOKENPASTE(FIST_TO_LIFT_NAME, _) = d_[STRINGIFY_HELPER(FIST_TO_LIFT_NAME)].GetBool();
+            // assert(d[STRINGIFY(SCROLLING_SPEED_NAME)].IsFloat());
+            TOKENPASTE(FIST_TO_LIFT_NAME, _) = d[STRINGIFY_HELPER(FIST_TO_LIFT_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(FIST_TO_LIFT_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(RIGHT_CLICK_ACTIVE_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(RIGHT_CLICK_ACTIVE_NAME)))
         {
-            // assert(d_[STRINGIFY(RIGHT_CLICK_ACTIVE_NAME)].IsBool());
-            TOKENPASTE(RIGHT_CLICK_ACTIVE_NAME, _) = d_[STRINGIFY_HELPER(RIGHT_CLICK_ACTIVE_NAME)].GetBool();
+            // assert(d[STRINGIFY(RIGHT_CLICK_ACTIVE_NAME)].IsBool());
+            TOKENPASTE(RIGHT_CLICK_ACTIVE_NAME, _) = d[STRINGIFY_HELPER(RIGHT_CLICK_ACTIVE_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(RIGHT_CLICK_ACTIVE_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(LOCK_MOUSE_ON_SCROLL_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(LOCK_MOUSE_ON_SCROLL_NAME)))
         {
-            // assert(d_[STRINGIFY(LOCK_MOUSE_ON_SCROLL_NAME)].IsBool());
-            TOKENPASTE(LOCK_MOUSE_ON_SCROLL_NAME, _) = d_[STRINGIFY_HELPER(LOCK_MOUSE_ON_SCROLL_NAME)].GetBool();
+            // assert(d[STRINGIFY(LOCK_MOUSE_ON_SCROLL_NAME)].IsBool());
+            TOKENPASTE(LOCK_MOUSE_ON_SCROLL_NAME, _) = d[STRINGIFY_HELPER(LOCK_MOUSE_ON_SCROLL_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(LOCK_MOUSE_ON_SCROLL_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(SCROLLING_ON_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(SCROLLING_ON_NAME)))
         {
-            // assert(d_[STRINGIFY(SCROLLING_ON_NAME)].IsBool());
-            TOKENPASTE(SCROLLING_ON_NAME, _) = d_[STRINGIFY_HELPER(SCROLLING_ON_NAME)].GetBool();
+            // assert(d[STRINGIFY(SCROLLING_ON_NAME)].IsBool());
+            TOKENPASTE(SCROLLING_ON_NAME, _) = d[STRINGIFY_HELPER(SCROLLING_ON_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(SCROLLING_ON_NAME) " not found!\n");
         }
         
-        if (d_.HasMember(STRINGIFY_HELPER(SCROLLING_SPEED_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(SCROLLING_SPEED_NAME)))
         {
-            // assert(d_[STRINGIFY(SCROLLING_SPEED_NAME)].IsFloat());
-            TOKENPASTE(SCROLLING_SPEED_NAME, _) = d_[STRINGIFY_HELPER(SCROLLING_SPEED_NAME)].GetFloat();
+            // assert(d[STRINGIFY(SCROLLING_SPEED_NAME)].IsFloat());
+            TOKENPASTE(SCROLLING_SPEED_NAME, _) = d[STRINGIFY_HELPER(SCROLLING_SPEED_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(SCROLLING_SPEED_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(SCROLL_THRESHOLD_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(SCROLL_THRESHOLD_NAME)))
         {
-            // assert(d_[STRINGIFY(SCROLL_THRESHOLD_NAME)].IsFloat());
-            TOKENPASTE(SCROLL_THRESHOLD_NAME, _) = d_[STRINGIFY_HELPER(SCROLL_THRESHOLD_NAME)].GetFloat();
+            // assert(d[STRINGIFY(SCROLL_THRESHOLD_NAME)].IsFloat());
+            TOKENPASTE(SCROLL_THRESHOLD_NAME, _) = d[STRINGIFY_HELPER(SCROLL_THRESHOLD_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(SCROLL_THRESHOLD_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(INDEX_PINCH_THRESHOLD_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(INDEX_PINCH_THRESHOLD_NAME)))
         {
-            // assert(d_[STRINGIFY(INDEX_PINCH_THRESHOLD_NAME)].IsFloat());
-            TOKENPASTE(INDEX_PINCH_THRESHOLD_NAME, _) = d_[STRINGIFY_HELPER(INDEX_PINCH_THRESHOLD_NAME)].GetFloat();
+            // assert(d[STRINGIFY(INDEX_PINCH_THRESHOLD_NAME)].IsFloat());
+            TOKENPASTE(INDEX_PINCH_THRESHOLD_NAME, _) = d[STRINGIFY_HELPER(INDEX_PINCH_THRESHOLD_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(INDEX_PINCH_THRESHOLD_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(USE_ABSOLUTE_MOUSE_POSITION)))
+        if (d.HasMember(STRINGIFY_HELPER(USE_ABSOLUTE_MOUSE_POSITION)))
         {
-            // assert(d_[STRINGIFY(USE_ABSOLUTE_MOUSE_POSITION)].IsBool());
-            TOKENPASTE(USE_ABSOLUTE_MOUSE_POSITION, _) = d_[STRINGIFY_HELPER(USE_ABSOLUTE_MOUSE_POSITION)].GetBool();
+            // assert(d[STRINGIFY(USE_ABSOLUTE_MOUSE_POSITION)].IsBool());
+            TOKENPASTE(USE_ABSOLUTE_MOUSE_POSITION, _) = d[STRINGIFY_HELPER(USE_ABSOLUTE_MOUSE_POSITION)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(USE_ABSOLUTE_MOUSE_POSITION) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_LEFT_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_LEFT_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_WIDTH_LEFT_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_LEFT_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_LEFT_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_WIDTH_LEFT_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_LEFT_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_LEFT_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_LEFT_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_RIGHT_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_RIGHT_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_WIDTH_RIGHT_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_RIGHT_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_RIGHT_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_WIDTH_RIGHT_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_RIGHT_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_RIGHT_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_RIGHT_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_LOWER_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_LOWER_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_HEIGHT_LOWER_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_LOWER_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_LOWER_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_HEIGHT_LOWER_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_LOWER_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_LOWER_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_LOWER_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_UPPER_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_UPPER_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_HEIGHT_UPPER_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_UPPER_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_UPPER_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_HEIGHT_UPPER_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_UPPER_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_UPPER_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_UPPER_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_NEAR_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_NEAR_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_NEAR_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_NEAR_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_NEAR_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_NEAR_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_NEAR_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_NEAR_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_NEAR_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(BOUNDS_FAR_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(BOUNDS_FAR_NAME)))
         {
-            // assert(d_[STRINGIFY(BOUNDS_FAR_NAME)].IsFloat());
-            TOKENPASTE(BOUNDS_FAR_NAME, _) = d_[STRINGIFY_HELPER(BOUNDS_FAR_NAME)].GetFloat();
+            // assert(d[STRINGIFY(BOUNDS_FAR_NAME)].IsFloat());
+            TOKENPASTE(BOUNDS_FAR_NAME, _) = d[STRINGIFY_HELPER(BOUNDS_FAR_NAME)].GetFloat();
         }
         else
         {
             printf(STRINGIFY_HELPER(BOUNDS_FAR_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)))
+        if (d.HasMember(STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)))
         {
-            // assert(d_[STRINGIFY(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)].IsBool());
-            TOKENPASTE(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME, _) = d_[STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)].GetBool();
+            // assert(d[STRINGIFY(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)].IsBool());
+            TOKENPASTE(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME, _) = d[STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME)].GetBool();
         }
         else
         {
             printf(STRINGIFY_HELPER(LIMIT_TRACKING_TO_WITHIN_BOUNDS_NAME) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(LEAP_CAMERA_MODE)))
+        if (d.HasMember(STRINGIFY_HELPER(LEAP_CAMERA_MODE)))
         {
-            // assert(d_[STRINGIFY(LEAP_CAMERA_MODE)].IsBool());
-            TOKENPASTE(LEAP_CAMERA_MODE, _) = d_[STRINGIFY_HELPER(LEAP_CAMERA_MODE)].GetString();
+            // assert(d[STRINGIFY(LEAP_CAMERA_MODE)].IsBool());
+            TOKENPASTE(LEAP_CAMERA_MODE, _) = d[STRINGIFY_HELPER(LEAP_CAMERA_MODE)].GetString();
         }
         else
         {
             printf(STRINGIFY_HELPER(LEAP_CAMERA_MODE) " not found!\n");
         }
 
-        if (d_.HasMember(STRINGIFY_HELPER(HANDEDNESS)))
+        if (d.HasMember(STRINGIFY_HELPER(HANDEDNESS)))
         {
-            // assert(d_[STRINGIFY(HANDEDNESS)].IsBool());
-            TOKENPASTE(HANDEDNESS, _) = d_[STRINGIFY_HELPER(HANDEDNESS)].GetString();
+            // assert(d[STRINGIFY(HANDEDNESS)].IsBool());
+            TOKENPASTE(HANDEDNESS, _) = d[STRINGIFY_HELPER(HANDEDNESS)].GetString();
         }
         else
         {
             printf(STRINGIFY_HELPER(HANDEDNESS) " not found!\n");
         }
+
+        if (d.HasMember(STRINGIFY_HELPER(MOUSE_BACKEND_NAME)))
+        {
+            // assert(d[STRINGIFY(MOUSE_BACKEND_NAME)].IsString());
+            TOKENPASTE(MOUSE_BACKEND_NAME, _) = d[STRINGIFY_HELPER(MOUSE_BACKEND_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(MOUSE_BACKEND_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(POLL_STRATEGY_NAME)))
+        {
+            // assert(d[STRINGIFY(POLL_STRATEGY_NAME)].IsString());
+            TOKENPASTE(POLL_STRATEGY_NAME, _) = d[STRINGIFY_HELPER(POLL_STRATEGY_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(POLL_STRATEGY_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(POLL_TIMEOUT_NAME)))
+        {
+            // assert(d[STRINGIFY(POLL_TIMEOUT_NAME)].IsFloat());
+            TOKENPASTE(POLL_TIMEOUT_NAME, _) = d[STRINGIFY_HELPER(POLL_TIMEOUT_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(POLL_TIMEOUT_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(POLL_SPIN_TIME_NAME)))
+        {
+            // assert(d[STRINGIFY(POLL_SPIN_TIME_NAME)].IsFloat());
+            TOKENPASTE(POLL_SPIN_TIME_NAME, _) = d[STRINGIFY_HELPER(POLL_SPIN_TIME_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(POLL_SPIN_TIME_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(RECORDING_PATH_NAME)))
+        {
+            // assert(d[STRINGIFY(RECORDING_PATH_NAME)].IsString());
+            TOKENPASTE(RECORDING_PATH_NAME, _) = d[STRINGIFY_HELPER(RECORDING_PATH_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(RECORDING_PATH_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(RECORDING_CAPACITY_NAME)))
+        {
+            // assert(d[STRINGIFY(RECORDING_CAPACITY_NAME)].IsFloat());
+            TOKENPASTE(RECORDING_CAPACITY_NAME, _) = d[STRINGIFY_HELPER(RECORDING_CAPACITY_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(RECORDING_CAPACITY_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(DISPLAY_REFRESH_RATE_NAME)))
+        {
+            // assert(d[STRINGIFY(DISPLAY_REFRESH_RATE_NAME)].IsFloat());
+            TOKENPASTE(DISPLAY_REFRESH_RATE_NAME, _) = d[STRINGIFY_HELPER(DISPLAY_REFRESH_RATE_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(DISPLAY_REFRESH_RATE_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(POSITION_FILTER_ACTIVE_NAME)))
+        {
+            // assert(d[STRINGIFY(POSITION_FILTER_ACTIVE_NAME)].IsBool());
+            TOKENPASTE(POSITION_FILTER_ACTIVE_NAME, _) = d[STRINGIFY_HELPER(POSITION_FILTER_ACTIVE_NAME)].GetBool();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(POSITION_FILTER_ACTIVE_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(FILTER_MIN_CUTOFF_NAME)))
+        {
+            // assert(d[STRINGIFY(FILTER_MIN_CUTOFF_NAME)].IsFloat());
+            TOKENPASTE(FILTER_MIN_CUTOFF_NAME, _) = d[STRINGIFY_HELPER(FILTER_MIN_CUTOFF_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(FILTER_MIN_CUTOFF_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(FILTER_BETA_NAME)))
+        {
+            // assert(d[STRINGIFY(FILTER_BETA_NAME)].IsFloat());
+            TOKENPASTE(FILTER_BETA_NAME, _) = d[STRINGIFY_HELPER(FILTER_BETA_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(FILTER_BETA_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(PREDICTION_LEAD_NAME)))
+        {
+            // assert(d[STRINGIFY(PREDICTION_LEAD_NAME)].IsFloat());
+            TOKENPASTE(PREDICTION_LEAD_NAME, _) = d[STRINGIFY_HELPER(PREDICTION_LEAD_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(PREDICTION_LEAD_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(DEVICES_NAME)))
+        {
+            // assert(d[STRINGIFY(DEVICES_NAME)].IsString());
+            TOKENPASTE(DEVICES_NAME, _) = d[STRINGIFY_HELPER(DEVICES_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(DEVICES_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(BIMANUAL_CURSOR_HAND_NAME)))
+        {
+            // assert(d[STRINGIFY(BIMANUAL_CURSOR_HAND_NAME)].IsString());
+            TOKENPASTE(BIMANUAL_CURSOR_HAND_NAME, _) = d[STRINGIFY_HELPER(BIMANUAL_CURSOR_HAND_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(BIMANUAL_CURSOR_HAND_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(MONITORS_NAME)))
+        {
+            // assert(d[STRINGIFY(MONITORS_NAME)].IsString());
+            TOKENPASTE(MONITORS_NAME, _) = d[STRINGIFY_HELPER(MONITORS_NAME)].GetString();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(MONITORS_NAME) " not found!\n");
+        }
+
+        if (d.HasMember(STRINGIFY_HELPER(SAMPLE_RATE_NAME)))
+        {
+            // assert(d[STRINGIFY(SAMPLE_RATE_NAME)].IsFloat());
+            TOKENPASTE(SAMPLE_RATE_NAME, _) = d[STRINGIFY_HELPER(SAMPLE_RATE_NAME)].GetFloat();
+        }
+        else
+        {
+            printf(STRINGIFY_HELPER(SAMPLE_RATE_NAME) " not found!\n");
+        }
     }
 };
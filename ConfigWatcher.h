@@ -0,0 +1,202 @@
+#pragma once
+
+#include "ConfigReader.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+// How long the watching thread waits for a change before checking whether it should stop
+#define CONFIG_WATCH_POLL_MS 250
+// How long a snapshot is kept after a reload replaces it, for readers still partway through it
+#define CONFIG_SNAPSHOT_GRACE_MS 2000
+
+// Keeps the latest settings from a config file, reloading them on a thread of its own whenever
+// the file changes. Only Linux watches the file (with inotify), elsewhere the first load is kept.
+// Each load is an immutable snapshot that readers reach with one atomic load, so they never
+// wait on, or copy, a reload.
+class ConfigWatcher
+{
+    public:
+        // Applied to every snapshot before it's published, e.g. the command line's overrides
+        typedef std::function<void(ConfigReader&)> config_adjust_t;
+
+        ConfigWatcher(const std::string& path, config_adjust_t adjust = nullptr) :
+            path_(path),
+            adjust_(adjust)
+        {
+            std::unique_ptr<ConfigReader> first(new ConfigReader(path_));
+            if (adjust_)
+            {
+                adjust_(*first);
+            }
+            current_.store(first.get(), std::memory_order_release);
+            currentSnapshot_ = std::move(first);
+        }
+
+        ~ConfigWatcher()
+        {
+            Stop();
+        }
+
+        ConfigWatcher(const ConfigWatcher&) = delete;
+        ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+        // The latest snapshot. Until Start() it stays valid for as long as the watcher does, after
+        // that only for CONFIG_SNAPSHOT_GRACE_MS once a reload has replaced it, so don't keep the
+        // reference beyond handling one frame or event.
+        const ConfigReader& Get() const
+        {
+            return *current_.load(std::memory_order_acquire);
+        }
+
+        // Counts up with every reload, so readers can tell cheaply that something changed
+        uint64_t GetGeneration() const
+        {
+            return generation_.load(std::memory_order_acquire);
+        }
+
+        // Returns "false" if the file can't be watched here
+        bool Start()
+        {
+#ifdef __linux__
+            if (running_)
+            {
+                return true;
+            }
+
+            // Editors often save by renaming a new file over the old one, so watch the directory
+            const size_t separator = path_.find_last_of('/');
+            const std::string directory = separator == std::string::npos ? "." : path_.substr(0, separator);
+            fileName_ = separator == std::string::npos ? path_ : path_.substr(separator + 1);
+
+            inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (inotifyFd_ < 0)
+            {
+                printf("Could not watch the config file, changes need a restart.\n");
+                return false;
+            }
+            if (inotify_add_watch(inotifyFd_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+            {
+                printf("Could not watch %s, changes need a restart.\n", directory.c_str());
+                close(inotifyFd_);
+                inotifyFd_ = -1;
+                return false;
+            }
+
+            running_ = true;
+            thread_ = std::thread(&ConfigWatcher::run, this);
+            return true;
+#else
+            return false;
+#endif // __linux__
+        }
+
+        void Stop()
+        {
+#ifdef __linux__
+            if (running_)
+            {
+                running_ = false;
+                thread_.join();
+                close(inotifyFd_);
+                inotifyFd_ = -1;
+            }
+#endif // __linux__
+        }
+
+    private:
+#ifdef __linux__
+        void run()
+        {
+            struct pollfd pfd = {inotifyFd_, POLLIN, 0};
+            alignas(struct inotify_event) char buffer[4096];
+
+            while (running_)
+            {
+                freeRetiredSnapshots();
+                if (poll(&pfd, 1, CONFIG_WATCH_POLL_MS) <= 0)
+                {
+                    continue;
+                }
+
+                bool changed = false;
+                ssize_t length;
+                while ((length = read(inotifyFd_, buffer, sizeof(buffer))) > 0)
+                {
+                    for (char* p = buffer; p < buffer + length; )
+                    {
+                        const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+                        changed = changed || (event->len > 0 && fileName_ == event->name);
+                        p += sizeof(struct inotify_event) + event->len;
+                    }
+                }
+
+                if (changed)
+                {
+                    reload();
+                }
+            }
+        }
+#endif // __linux__
+
+        void reload()
+        {
+            std::unique_ptr<ConfigReader> next(new ConfigReader(path_));
+            if (!next->Loaded())
+            {
+                printf("Config file changed but couldn't be loaded, keeping the current settings.\n");
+                return;
+            }
+            if (adjust_)
+            {
+                adjust_(*next);
+            }
+
+            current_.store(next.get(), std::memory_order_release);
+            generation_.fetch_add(1, std::memory_order_acq_rel);
+            // A reader may still be partway through the old snapshot, so it's kept for a while
+            retired_.push_back(RetiredSnapshot{std::move(currentSnapshot_), std::chrono::steady_clock::now()});
+            currentSnapshot_ = std::move(next);
+            printf("Reloaded %s\n", path_.c_str());
+        }
+
+        void freeRetiredSnapshots()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            while (!retired_.empty() &&
+                   now - retired_.front().retiredAt >= std::chrono::milliseconds(CONFIG_SNAPSHOT_GRACE_MS))
+            {
+                retired_.pop_front();
+            }
+        }
+
+    private:
+        std::string path_;
+        config_adjust_t adjust_;
+
+        std::atomic<const ConfigReader*> current_{nullptr};
+        std::atomic<uint64_t> generation_{0};
+        // Only the watching thread touches these once it has started
+        struct RetiredSnapshot {
+            std::unique_ptr<const ConfigReader> snapshot;
+            std::chrono::steady_clock::time_point retiredAt;
+        };
+        std::unique_ptr<const ConfigReader> currentSnapshot_;
+        std::deque<RetiredSnapshot> retired_;
+
+        std::thread thread_;
+        std::atomic<bool> running_{false};
+        std::string fileName_;
+        int inotifyFd_ = -1;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ConfigReader.h"
+#include "MouseOutputThread.h"
+
+#include <LeapC.h>
+
+enum class CursorMode {
+    Relative,   // Moves by how far the hand moved, scaled by the speed
+    Absolute    // Puts the cursor where the hand is within the bounds
+};
+
+// What a palm position becomes on the way to the cursor, worked out once from the config. The
+// per-frame step is a template instantiated for the config's mode, orientation and scroll lock,
+// so it doesn't look at any of them while frames are flowing.
+class PositionPipeline
+{
+    public:
+        // directionSwap is -1 when the tracking mode mirrors the hand, e.g. screentop
+        void Configure(const ConfigReader& config, const int directionSwap)
+        {
+            params_.speed = config.GetSpeed();
+
+            // Bounds in LeapC's millimetres, and their reciprocal sizes to map them to 0 to 1
+            params_.leftMm = -config.GetBoundsLeftMeters() * 1000.f;
+            params_.upperMm = config.GetBoundsUpperMeters() * 1000.f;
+            params_.xScale = 1.f / ((config.GetBoundsRightMeters() + config.GetBoundsLeftMeters()) * 1000.f);
+            params_.yScale = 1.f / ((config.GetBoundsUpperMeters() - config.GetBoundsLowerMeters()) * 1000.f);
+
+            const bool lock = config.GetLockMouseOnScroll();
+            if (config.GetUseAbsoluteMousePosition())
+            {
+                // The screen doesn't mirror, so the signs don't matter here
+                step_ = lock ? &run<CursorMode::Absolute, 1, 1, true> : &run<CursorMode::Absolute, 1, 1, false>;
+            }
+            else if (directionSwap < 0)
+            {
+                step_ = config.GetVerticalOrientation() ? selectLock<-1, 1>(lock) : selectLock<-1, -1>(lock);
+            }
+            else
+            {
+                step_ = config.GetVerticalOrientation() ? selectLock<1, -1>(lock) : selectLock<1, 1>(lock);
+            }
+        }
+
+        // Queues the cursor update for a palm at v that was at prev on the last frame
+        void Run(const LEAP_VECTOR& v, const LEAP_VECTOR& prev, const bool scrolling, MouseOutputThread& output) const
+        {
+            step_(params_, v, prev, scrolling, output);
+        }
+
+    private:
+        struct Params {
+            float speed;
+            float leftMm;
+            float upperMm;
+            float xScale;
+            float yScale;
+        };
+
+        typedef void (*step_t)(const Params&, const LEAP_VECTOR&, const LEAP_VECTOR&, const bool, MouseOutputThread&);
+
+        template <CursorMode Mode, int XSign, int YSign, bool LockOnScroll>
+        static void run(const Params& params, const LEAP_VECTOR& v, const LEAP_VECTOR& prev, const bool scrolling, MouseOutputThread& output)
+        {
+            if (LockOnScroll && scrolling)
+            {
+                return;
+            }
+
+            if (Mode == CursorMode::Absolute)
+            {
+                // The output thread scales these to the screen
+                output.Push(MouseCommand::Of(MouseCommandType::SetFraction,
+                                             (v.x - params.leftMm) * params.xScale,
+                                             (params.upperMm - v.y) * params.yScale));
+            }
+            else
+            {
+                // Kept fractional, the output thread carries what doesn't make a whole pixel
+                output.Push(MouseCommand::Of(MouseCommandType::Move,
+                                             params.speed * (v.x - prev.x) * XSign,
+                                             params.speed * (v.y - prev.y) * YSign));
+            }
+        }
+
+        template <int XSign, int YSign>
+        static step_t selectLock(const bool lock)
+        {
+            return lock ? &run<CursorMode::Relative, XSign, YSign, true> : &run<CursorMode::Relative, XSign, YSign, false>;
+        }
+
+    private:
+        Params params_ = {};
+        step_t step_ = &run<CursorMode::Relative, 1, 1, false>;
+};
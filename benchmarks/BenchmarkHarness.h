@@ -0,0 +1,183 @@
+#pragma once
+
+#include "UltraleapPoller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define BENCHMARK_DEFAULT_FRAMES 4096
+#define BENCHMARK_DEFAULT_REPETITIONS 200
+#define BENCHMARK_DEFAULT_TRIALS 7
+#define BENCHMARK_DEFAULT_SEED 1
+// Matches the shipped fledermaus_config.json
+#define BENCHMARK_DEFAULT_INDEX_PINCH_THRESHOLD 35.f
+
+struct BenchmarkResult
+{
+	std::string name;
+	double medianNsPerFrame;
+	double minNsPerFrame;
+	uint64_t count; // Whatever the pass counts, e.g. hits or callbacks, per pass over the frames
+};
+
+struct BenchmarkOptions
+{
+	std::string recordingPath;
+	std::string outputPath;
+	size_t frames = BENCHMARK_DEFAULT_FRAMES;
+	size_t repetitions = BENCHMARK_DEFAULT_REPETITIONS;
+	size_t trials = BENCHMARK_DEFAULT_TRIALS;
+	uint32_t seed = BENCHMARK_DEFAULT_SEED;
+};
+
+// A field for the top of the JSON output, its value already formatted as JSON
+struct BenchmarkField
+{
+	const char* name;
+	std::string value;
+};
+
+// Times `pass`, a pass over `frames` frames returning what it counted, and reports the median
+// and fastest of the trials
+template <typename Pass>
+BenchmarkResult time_benchmark(const char* name, const BenchmarkOptions& options, const size_t frames, Pass pass)
+{
+	// Warm the caches and branch predictors before timing anything
+	uint64_t count = pass();
+	// Keeps the optimiser from throwing away results nobody looks at
+	volatile uint64_t sink = 0;
+	std::vector<double> nsPerFrame;
+
+	for (size_t t = 0; t < options.trials; t++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < options.repetitions; r++)
+		{
+			sink = sink + pass();
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		nsPerFrame.push_back(ns / static_cast<double>(options.repetitions * frames));
+	}
+
+	std::sort(nsPerFrame.begin(), nsPerFrame.end());
+	BenchmarkResult result;
+	result.name = name;
+	result.medianNsPerFrame = nsPerFrame[nsPerFrame.size() / 2];
+	result.minNsPerFrame = nsPerFrame.front();
+	result.count = count;
+	return result;
+}
+
+// `framesFlag` is the option that sets options.frames, e.g. "--hands". --recording is only
+// taken with `takesRecording`.
+inline bool parse_benchmark_command_line(BenchmarkOptions& options, int argc, char** argv, const char* framesFlag, const bool takesRecording)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (takesRecording && strcmp(argv[i], "--recording") == 0 && hasValue)
+		{
+			options.recordingPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--output") == 0 && hasValue)
+		{
+			options.outputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], framesFlag) == 0 && hasValue)
+		{
+			options.frames = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--repetitions") == 0 && hasValue)
+		{
+			options.repetitions = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--trials") == 0 && hasValue)
+		{
+			options.trials = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue)
+		{
+			options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			printf("Unknown or incomplete argument %s\n", argv[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Writes the results to --output, or stdout without it. `countName` is what each result's
+// count is called in the output.
+inline bool write_benchmark_json(const BenchmarkOptions& options, const char* benchmark, const std::vector<BenchmarkField>& fields,
+                                 const char* countName, const std::vector<BenchmarkResult>& results)
+{
+	FILE* out = stdout;
+	if (!options.outputPath.empty())
+	{
+		out = fopen(options.outputPath.c_str(), "w");
+		if (out == nullptr)
+		{
+			printf("Could not open %s for writing.\n", options.outputPath.c_str());
+			return false;
+		}
+	}
+
+	fprintf(out, "{\n");
+	fprintf(out, "  \"benchmark\": \"%s\",\n", benchmark);
+	for (const BenchmarkField& field : fields)
+	{
+		fprintf(out, "  \"%s\": %s,\n", field.name, field.value.c_str());
+	}
+	fprintf(out, "  \"repetitions\": %zu,\n", options.repetitions);
+	fprintf(out, "  \"trials\": %zu,\n", options.trials);
+	fprintf(out, "  \"results\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		fprintf(out, "    {\"name\": \"%s\", \"ns_per_frame\": %.3f, \"min_ns_per_frame\": %.3f, \"%s\": %llu}%s\n",
+		        results[i].name.c_str(),
+		        results[i].medianNsPerFrame,
+		        results[i].minNsPerFrame,
+		        countName,
+		        static_cast<unsigned long long>(results[i].count),
+		        i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+
+	if (out != stdout)
+	{
+		fclose(out);
+	}
+	return true;
+}
+
+// Either the gestures Fledermaus itself listens for, or all of the built-in ones
+inline void bind_gesture_callbacks(UltraleapPoller& poller, gesture_callback_t callback, const bool all)
+{
+#define BindGestureCallbacks(name) \
+	poller.SetOn##name##StartCallback(callback); \
+	poller.SetOn##name##ContinueCallback(callback); \
+	poller.SetOn##name##StopCallback(callback);
+
+	BindGestureCallbacks(Fist);
+	BindGestureCallbacks(IndexPinch);
+	BindGestureCallbacks(V);
+	BindGestureCallbacks(AlmostRotate);
+	BindGestureCallbacks(Rotate);
+	if (all)
+	{
+		BindGestureCallbacks(AlmostPinch);
+		BindGestureCallbacks(Pinch);
+		BindGestureCallbacks(MiddlePinch);
+		BindGestureCallbacks(RingPinch);
+		BindGestureCallbacks(PinkyPinch);
+	}
+#undef BindGestureCallbacks
+}
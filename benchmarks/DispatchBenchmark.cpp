@@ -0,0 +1,155 @@
+// Times handing each tracking frame's hands to the callbacks. The way handleTrackingMessage
+// used to do it, copying each LEAP_HAND out of the frame and calling std::functions, is timed
+// against passing a pointer into the frame and calling CallbackRefs, with the same work behind
+// both. The poller's own handleTrackingMessage is timed too, with the callbacks Fledermaus binds.
+// Results are written as JSON so runs can be compared.
+//
+// $: ./DispatchBenchmark [--frames N] [--repetitions N] [--trials N] [--seed N] [--output file]
+
+#include "BenchmarkHarness.h"
+#include "SyntheticHands.h"
+
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+class DispatchBenchmark
+{
+	public:
+		DispatchBenchmark(UltraleapPoller& poller, const std::vector<LEAP_HAND>& hands, const BenchmarkOptions& options)
+			: poller_(poller), hands_(hands), options_(options), frames_(hands.size())
+		{
+			// One hand per frame, pointing into hands_ the way LeapC's frames point into its buffer
+			for (size_t f = 0; f < frames_.size(); f++)
+			{
+				memset(&frames_[f], 0, sizeof(frames_[f]));
+				frames_[f].nHands = 1;
+				frames_[f].pHands = const_cast<LEAP_HAND*>(&hands_[f]);
+				frames_[f].framerate = 120.f;
+			}
+		}
+
+		std::vector<BenchmarkResult> Run()
+		{
+			std::vector<BenchmarkResult> results;
+
+			std::function<void(LEAP_VECTOR)> positionFunction = [this](LEAP_VECTOR v) { onPosition(v); };
+			std::function<void(const int64_t, const LEAP_HAND&)> gestureFunction = [this](const int64_t timestamp, const LEAP_HAND& hand) { onGesture(timestamp, hand); };
+			results.push_back(time_benchmark("copy_hand_std_function", options_, frames_.size(), [&]()
+			{
+				uint64_t before = calls_;
+				for (const LEAP_TRACKING_EVENT& frame : frames_)
+				{
+					for (uint32_t h = 0; h < frame.nHands; h++)
+					{
+						LEAP_HAND hand = frame.pHands[h];
+						positionFunction(hand.palm.position);
+						gestureFunction(frame.info.timestamp, hand);
+					}
+				}
+				return calls_ - before;
+			}));
+
+			const position_callback_t positionRef = position_callback_t::Bind<DispatchBenchmark, &DispatchBenchmark::onPosition>(*this);
+			const gesture_callback_t gestureRef = gesture_callback_t::Bind<DispatchBenchmark, &DispatchBenchmark::onGesture>(*this);
+			results.push_back(time_benchmark("pointer_hand_callback_ref", options_, frames_.size(), [&]()
+			{
+				uint64_t before = calls_;
+				for (const LEAP_TRACKING_EVENT& frame : frames_)
+				{
+					for (uint32_t h = 0; h < frame.nHands; h++)
+					{
+						const LEAP_HAND* hand = &frame.pHands[h];
+						positionRef(hand->palm.position);
+						gestureRef(frame.info.timestamp, *hand);
+					}
+				}
+				return calls_ - before;
+			}));
+
+			// The whole of the poller's frame handling, gestures included
+			bindCallbacks();
+			results.push_back(time_benchmark("handleTrackingMessage", options_, frames_.size(), [this]()
+			{
+				uint64_t before = calls_;
+				for (LEAP_TRACKING_EVENT& frame : frames_)
+				{
+					// Every frame follows on from the one before, however many passes there are
+					frameId_++;
+					frame.tracking_frame_id = frameId_;
+					frame.info.frame_id = frameId_;
+					frame.info.timestamp = static_cast<int64_t>(frameId_) * 8333;
+					poller_.HandleTrackingFrame(&frame, latency_clock_us());
+				}
+				return calls_ - before;
+			}));
+
+			return results;
+		}
+
+	private:
+		// The gestures and callbacks Fledermaus itself binds
+		void bindCallbacks()
+		{
+			bind_gesture_callbacks(poller_, gesture_callback_t::Bind<DispatchBenchmark, &DispatchBenchmark::onGesture>(*this), false);
+			poller_.SetPositionCallback(position_callback_t::Bind<DispatchBenchmark, &DispatchBenchmark::onPosition>(*this));
+			poller_.SetOnFrameEndCallback(frame_callback_t::Bind<DispatchBenchmark, &DispatchBenchmark::onFrameEnd>(*this));
+		}
+
+		// Enough work that the calls can't be left out
+		void onPosition(LEAP_VECTOR v)
+		{
+			calls_++;
+			positionSum_ += v.x + v.y + v.z;
+		}
+
+		void onGesture(const int64_t timestamp, const LEAP_HAND& hand)
+		{
+			calls_++;
+			positionSum_ += hand.palm.position.x + static_cast<float>(timestamp & 1);
+		}
+
+		void onFrameEnd(const int64_t)
+		{
+			calls_++;
+		}
+
+		UltraleapPoller& poller_;
+		const std::vector<LEAP_HAND>& hands_;
+		const BenchmarkOptions& options_;
+		std::vector<LEAP_TRACKING_EVENT> frames_;
+		uint64_t frameId_ = 0;
+		uint64_t calls_ = 0;
+
+	public:
+		// Keeps the optimiser from throwing away results nobody looks at
+		volatile float positionSum_ = 0.f;
+};
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!parse_benchmark_command_line(options, argc, argv, "--frames", false))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::vector<LEAP_HAND> hands = synthetic_hands(options.frames, options.seed);
+
+	UltraleapPoller poller;
+	poller.SetIndexPinchThreshold(BENCHMARK_DEFAULT_INDEX_PINCH_THRESHOLD);
+
+	DispatchBenchmark benchmark(poller, hands, options);
+	std::vector<BenchmarkResult> results = benchmark.Run();
+
+	const std::vector<BenchmarkField> fields = {
+		{"frames", std::to_string(options.frames)},
+		{"hand_bytes", std::to_string(sizeof(LEAP_HAND))},
+	};
+	if (!write_benchmark_json(options, "dispatch", fields, "calls", results))
+	{
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
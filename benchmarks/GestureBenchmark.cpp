@@ -0,0 +1,231 @@
+// Times the gesture detection run on every tracking frame: feature extraction, each is* test
+// on its own, and the full set of checks handleTrackingMessage makes for the active hand. Also
+// times the batch classifier with each kernel this CPU supports, failing if any of them
+// disagrees with the tests. Results are written as JSON so runs can be compared.
+//
+// $: ./GestureBenchmark [--recording file] [--hands N] [--repetitions N] [--trials N]
+//                       [--seed N] [--output file]
+
+#include "BenchmarkHarness.h"
+#include "FrameReplayer.h"
+#include "GestureBatch.h"
+#include "SyntheticHands.h"
+
+#include <string>
+#include <vector>
+
+class GestureBenchmark
+{
+	public:
+		GestureBenchmark(UltraleapPoller& poller, const std::vector<LEAP_HAND>& hands, const BenchmarkOptions& options)
+			: poller_(poller), hands_(hands), options_(options)
+		{
+		}
+
+		std::vector<BenchmarkResult> Run()
+		{
+			struct NamedTest
+			{
+				const char* name;
+				int gesture;
+			};
+
+			// In id order, so each test's bit in the batch classifier's masks is its index here
+			const NamedTest tests[] = {
+				{"isAlmostPinch",  GestureAlmostPinch},
+				{"isPinch",        GesturePinch},
+				{"isIndexPinch",   GestureIndexPinch},
+				{"isMiddlePinch",  GestureMiddlePinch},
+				{"isRingPinch",    GestureRingPinch},
+				{"isPinkyPinch",   GesturePinkyPinch},
+				{"isFist",         GestureFist},
+				{"isV",            GestureV},
+				{"isAlmostRotate", GestureAlmostRotate},
+				{"isRotate",       GestureRotate},
+			};
+
+			std::vector<BenchmarkResult> results;
+			std::vector<HandFeatures> features(hands_.size());
+
+			results.push_back(time_benchmark("extractHandFeatures", options_, hands_.size(), [this, &features]()
+			{
+				for (size_t h = 0; h < hands_.size(); h++)
+				{
+					poller_.ExtractHandFeatures(&hands_[h], features[h]);
+				}
+				return static_cast<uint64_t>(0);
+			}));
+
+			// The tests themselves, on features already extracted
+			for (const NamedTest& test : tests)
+			{
+				results.push_back(time_benchmark(test.name, options_, hands_.size(), [this, &test, &features]()
+				{
+					uint64_t hits = 0;
+					for (size_t h = 0; h < hands_.size(); h++)
+					{
+						hits += poller_.TestGesture(test.gesture, hands_[h], features[h]) ? 1 : 0;
+					}
+					return hits;
+				}));
+			}
+
+			// The batch classifier, which has to agree with the tests above on every frame
+			std::vector<uint16_t> expected(hands_.size(), 0);
+			for (size_t h = 0; h < hands_.size(); h++)
+			{
+				for (size_t t = 0; t < sizeof(tests) / sizeof(tests[0]); t++)
+				{
+					expected[h] |= poller_.TestGesture(tests[t].gesture, hands_[h], features[h]) ? (1u << t) : 0;
+				}
+			}
+
+			GestureFrameBatch batch;
+			batch.Reserve(hands_.size());
+			for (const LEAP_HAND& hand : hands_)
+			{
+				batch.Add(hand);
+			}
+
+			const GestureThresholds thresholds = poller_.GetGestureThresholds();
+			std::vector<uint16_t> masks(hands_.size());
+			const GestureBatchKernel kernels[] = {GestureBatchKernel::Scalar, GestureBatchKernel::SSE, GestureBatchKernel::AVX2};
+			for (GestureBatchKernel kernel : kernels)
+			{
+				if (!GestureBatchKernelSupported(kernel))
+				{
+					continue;
+				}
+
+				std::string name = std::string("batch_") + GestureBatchKernelName(kernel);
+				results.push_back(time_benchmark(name.c_str(), options_, hands_.size(), [&]()
+				{
+					ClassifyGestureBatch(batch, thresholds, masks.data(), kernel);
+					uint64_t gestures = 0;
+					for (uint16_t mask : masks)
+					{
+						gestures += mask != 0 ? 1 : 0;
+					}
+					return gestures;
+				}));
+
+				for (size_t h = 0; h < hands_.size(); h++)
+				{
+					if (masks[h] != expected[h])
+					{
+						printf("%s disagrees with the gesture tests on hand %zu: 0x%x, expected 0x%x\n",
+						       name.c_str(), h, masks[h], expected[h]);
+						batchMismatch_ = true;
+						break;
+					}
+				}
+			}
+
+			// With nothing listening no gesture is tested at all, with everything bound all of them are
+			results.push_back(timeChecks("gestureChecks"));
+
+			bindCallbacks(false);
+			results.push_back(timeChecks("gestureChecksMainCallbacks"));
+
+			bindCallbacks(true);
+			results.push_back(timeChecks("gestureChecksWithCallbacks"));
+
+			return results;
+		}
+
+		bool BatchMismatch() const
+		{
+			return batchMismatch_;
+		}
+
+	private:
+		BenchmarkResult timeChecks(const char* name)
+		{
+			return time_benchmark(name, options_, hands_.size(), [this]()
+			{
+				int64_t timestamp = 0;
+				uint64_t before = callbackCount_;
+				for (const LEAP_HAND& hand : hands_)
+				{
+					poller_.CheckGestures(HandSideRight, timestamp++, &hand);
+				}
+				return callbackCount_ - before;
+			});
+		}
+
+		void bindCallbacks(const bool all)
+		{
+			bind_gesture_callbacks(poller_, gesture_callback_t::Bind<GestureBenchmark, &GestureBenchmark::countCallback>(*this), all);
+		}
+
+		void countCallback(const int64_t, const LEAP_HAND&)
+		{
+			callbackCount_++;
+		}
+
+		UltraleapPoller& poller_;
+		const std::vector<LEAP_HAND>& hands_;
+		const BenchmarkOptions& options_;
+		uint64_t callbackCount_ = 0;
+		bool batchMismatch_ = false;
+};
+
+static bool recorded_hands(const std::string& path, std::vector<LEAP_HAND>& hands)
+{
+	FrameReplayer replayer;
+	if (!replayer.Open(path))
+	{
+		return false;
+	}
+
+	for (uint64_t i = 0; i < replayer.FrameCount(); i++)
+	{
+		const FrameRecord& record = replayer.Frame(i);
+		for (uint32_t h = 0; h < record.nHands; h++)
+		{
+			hands.push_back(record.hands[h]);
+		}
+	}
+
+	if (hands.empty())
+	{
+		printf("Recording %s has no hands in it.\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!parse_benchmark_command_line(options, argc, argv, "--hands", true))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::vector<LEAP_HAND> hands;
+	if (options.recordingPath.empty())
+	{
+		hands = synthetic_hands(options.frames, options.seed);
+	}
+	else if (!recorded_hands(options.recordingPath, hands))
+	{
+		return EXIT_FAILURE;
+	}
+
+	UltraleapPoller poller;
+	poller.SetIndexPinchThreshold(BENCHMARK_DEFAULT_INDEX_PINCH_THRESHOLD);
+
+	GestureBenchmark benchmark(poller, hands, options);
+	std::vector<BenchmarkResult> results = benchmark.Run();
+
+	const std::vector<BenchmarkField> fields = {
+		{"source", options.recordingPath.empty() ? "\"synthetic\"" : "\"recording\""},
+		{"hands", std::to_string(hands.size())},
+	};
+	if (!write_benchmark_json(options, "gestures", fields, "hits", results))
+	{
+		return EXIT_FAILURE;
+	}
+	return benchmark.BatchMismatch() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <LeapC.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+inline LEAP_VECTOR random_vector(std::mt19937& rng, float radius)
+{
+	std::uniform_real_distribution<float> coord(-radius, radius);
+	LEAP_VECTOR v;
+	v.x = coord(rng);
+	v.y = coord(rng);
+	v.z = coord(rng);
+	return v;
+}
+
+inline LEAP_VECTOR add(const LEAP_VECTOR& a, const LEAP_VECTOR& b)
+{
+	LEAP_VECTOR v;
+	v.x = a.x + b.x;
+	v.y = a.y + b.y;
+	v.z = a.z + b.z;
+	return v;
+}
+
+// Hands with fingertips scattered around the thumb tip and random strengths, so every test
+// comes out both ways rather than always taking the same branch
+inline std::vector<LEAP_HAND> synthetic_hands(size_t count, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<LEAP_HAND> hands(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		LEAP_HAND& hand = hands[i];
+		memset(&hand, 0, sizeof(hand));
+		hand.id = 1;
+		hand.type = eLeapHandType_Right;
+		hand.pinch_strength = unit(rng);
+		hand.grab_strength = unit(rng);
+		hand.palm.position = random_vector(rng, 100.f);
+		hand.palm.position.y += 200.f;
+
+		LEAP_VECTOR thumbTip = add(hand.palm.position, random_vector(rng, 60.f));
+		for (int d = 0; d < 5; d++)
+		{
+			LEAP_DIGIT& digit = hand.digits[d];
+			digit.finger_id = d;
+			for (int b = 0; b < 4; b++)
+			{
+				digit.bones[b].prev_joint = add(hand.palm.position, random_vector(rng, 50.f));
+				digit.bones[b].next_joint = add(digit.bones[b].prev_joint, random_vector(rng, 25.f));
+			}
+			digit.distal.next_joint = d == 0 ? thumbTip : add(thumbTip, random_vector(rng, 45.f));
+			digit.distal.prev_joint = add(digit.distal.next_joint, random_vector(rng, 20.f));
+		}
+	}
+
+	return hands;
+}
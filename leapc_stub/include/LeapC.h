@@ -0,0 +1,303 @@
+/* Stand-in for the subset of the Ultraleap LeapC API that Fledermaus uses.
+ *
+ * Declarations, layouts and values match the LeapC.h shipped with the Ultraleap
+ * SDK (5.x) so the rest of the tree compiles unchanged against either. Only what
+ * we call is declared here; see leapc_stub/src/LeapCStub.cpp for the behaviour.
+ */
+#ifndef _LEAP_C_H
+#define _LEAP_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#define LEAP_CALL __stdcall
+#else
+#define LEAP_CALL
+#endif
+
+/* The stub is always linked statically */
+#define LEAP_EXPORT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum _eLeapRS {
+  eLeapRS_Success                  = 0x00000000,
+  eLeapRS_UnknownError             = 0xE2010000,
+  eLeapRS_InvalidArgument          = 0xE2010001,
+  eLeapRS_InsufficientResources    = 0xE2010002,
+  eLeapRS_InsufficientBuffer       = 0xE2010003,
+  eLeapRS_Timeout                  = 0xE2010004,
+  eLeapRS_NotConnected             = 0xE2010005,
+  eLeapRS_HandshakeIncomplete      = 0xE2010006,
+  eLeapRS_BufferSizeOverflow       = 0xE2010007,
+  eLeapRS_ProtocolError            = 0xE2010008,
+  eLeapRS_InvalidClientID          = 0xE2010009,
+  eLeapRS_UnexpectedClosed         = 0xE201000A,
+  eLeapRS_UnknownImageFrameRequest = 0xE201000B,
+  eLeapRS_UnknownTrackingFrameID   = 0xE201000C,
+  eLeapRS_RoutineIsNotSeer         = 0xE201000D,
+  eLeapRS_TimestampTooEarly        = 0xE201000E,
+  eLeapRS_ConcurrentPoll           = 0xE201000F,
+  eLeapRS_NotAvailable             = 0xE7010002,
+  eLeapRS_NotStreaming             = 0xE7010004,
+  eLeapRS_CannotOpenDevice         = 0xE7010005,
+  eLeapRS_Unsupported              = 0xE7010006
+} eLeapRS;
+
+typedef struct _LEAP_CONNECTION *LEAP_CONNECTION;
+typedef struct _LEAP_DEVICE *LEAP_DEVICE;
+
+typedef enum _eLeapConnectionConfig {
+  eLeapConnectionConfig_MultiDeviceAware = 0x00000001
+} eLeapConnectionConfig;
+
+typedef enum _eLeapTrackingOrigin {
+  eLeapTrackingOrigin_DeviceCenter = 0,
+  eLeapTrackingOrigin_DevicePrimaryCamera = 1
+} eLeapTrackingOrigin;
+
+typedef struct _LEAP_CONNECTION_CONFIG {
+  uint32_t size;
+  uint32_t flags;
+  const char* server_namespace;
+  eLeapTrackingOrigin tracking_origin;
+} LEAP_CONNECTION_CONFIG;
+
+typedef enum _eLeapTrackingMode {
+  eLeapTrackingMode_Desktop = 0,
+  eLeapTrackingMode_HMD = 1,
+  eLeapTrackingMode_ScreenTop = 2,
+  eLeapTrackingMode_Unknown = 3
+} eLeapTrackingMode;
+
+typedef enum _eLeapDeviceStatus {
+  eLeapDeviceStatus_Streaming      = 0x00000001,
+  eLeapDeviceStatus_Paused         = 0x00000002,
+  eLeapDeviceStatus_Robust         = 0x00000004,
+  eLeapDeviceStatus_Smudged        = 0x00000008,
+  eLeapDeviceStatus_LowResource    = 0x00000010,
+  eLeapDeviceStatus_UnknownFailure = 0xE8010000,
+  eLeapDeviceStatus_BadCalibration = 0xE8010001,
+  eLeapDeviceStatus_BadFirmware    = 0xE8010002,
+  eLeapDeviceStatus_BadTransport   = 0xE8010003,
+  eLeapDeviceStatus_BadControl     = 0xE8010004
+} eLeapDeviceStatus;
+
+typedef enum _eLeapDevicePID {
+  eLeapDevicePID_Unknown         = 0x0000,
+  eLeapDevicePID_Peripheral      = 0x0003,
+  eLeapDevicePID_Rigel           = 0x1202,
+  eLeapDevicePID_SIR170          = 0x1203,
+  eLeapDevicePID_3Di             = 0x1204,
+  eLeapDevicePID_LMC2            = 0x1206,
+  eLeapDevicePID_Invalid         = 0xFFFFFFFF
+} eLeapDevicePID;
+
+typedef struct _LEAP_DEVICE_REF {
+  void* handle;
+  uint32_t id;
+} LEAP_DEVICE_REF;
+
+typedef struct _LEAP_DEVICE_INFO {
+  uint32_t size;
+  uint32_t status;
+  uint32_t caps;
+  eLeapDevicePID pid;
+  uint32_t baseline;
+  uint32_t serial_length;
+  char* serial;
+  float h_fov;
+  float v_fov;
+  uint32_t range;
+} LEAP_DEVICE_INFO;
+
+typedef struct _LEAP_VECTOR {
+  union {
+    float v[3];
+    struct {
+      float x;
+      float y;
+      float z;
+    };
+  };
+} LEAP_VECTOR;
+
+typedef struct _LEAP_QUATERNION {
+  union {
+    float v[4];
+    struct {
+      float x;
+      float y;
+      float z;
+      float w;
+    };
+  };
+} LEAP_QUATERNION;
+
+typedef struct _LEAP_BONE {
+  LEAP_VECTOR prev_joint;
+  LEAP_VECTOR next_joint;
+  float width;
+  LEAP_QUATERNION rotation;
+} LEAP_BONE;
+
+typedef struct _LEAP_DIGIT {
+  int32_t finger_id;
+  union {
+    LEAP_BONE bones[4];
+    struct {
+      LEAP_BONE metacarpal;
+      LEAP_BONE proximal;
+      LEAP_BONE intermediate;
+      LEAP_BONE distal;
+    };
+  };
+  uint32_t is_extended;
+} LEAP_DIGIT;
+
+typedef struct _LEAP_PALM {
+  LEAP_VECTOR position;
+  LEAP_VECTOR stabilized_position;
+  LEAP_VECTOR velocity;
+  LEAP_VECTOR normal;
+  float width;
+  LEAP_VECTOR direction;
+  LEAP_QUATERNION orientation;
+} LEAP_PALM;
+
+typedef enum _eLeapHandType {
+  eLeapHandType_Left,
+  eLeapHandType_Right
+} eLeapHandType;
+
+typedef struct _LEAP_HAND {
+  uint32_t id;
+  uint32_t flags;
+  eLeapHandType type;
+  float confidence;
+  uint64_t visible_time;
+  float pinch_distance;
+  float grab_angle;
+  float pinch_strength;
+  float grab_strength;
+  LEAP_PALM palm;
+  union {
+    struct {
+      LEAP_DIGIT thumb;
+      LEAP_DIGIT index;
+      LEAP_DIGIT middle;
+      LEAP_DIGIT ring;
+      LEAP_DIGIT pinky;
+    };
+    LEAP_DIGIT digits[5];
+  };
+  LEAP_BONE arm;
+} LEAP_HAND;
+
+typedef struct _LEAP_FRAME_HEADER {
+  void* reserved;
+  int64_t frame_id;
+  int64_t timestamp;
+} LEAP_FRAME_HEADER;
+
+typedef struct _LEAP_TRACKING_EVENT {
+  LEAP_FRAME_HEADER info;
+  int64_t tracking_frame_id;
+  uint32_t nHands;
+  LEAP_HAND* pHands;
+  float framerate;
+} LEAP_TRACKING_EVENT;
+
+typedef struct _LEAP_CONNECTION_EVENT {
+  uint32_t flags;
+} LEAP_CONNECTION_EVENT;
+
+typedef struct _LEAP_CONNECTION_LOST_EVENT {
+  uint32_t flags;
+} LEAP_CONNECTION_LOST_EVENT;
+
+typedef struct _LEAP_DEVICE_EVENT {
+  uint32_t flags;
+  LEAP_DEVICE_REF device;
+  uint32_t status;
+} LEAP_DEVICE_EVENT;
+
+typedef struct _LEAP_DEVICE_FAILURE_EVENT {
+  eLeapDeviceStatus status;
+  LEAP_DEVICE hDevice;
+} LEAP_DEVICE_FAILURE_EVENT;
+
+typedef struct _LEAP_TRACKING_MODE_EVENT {
+  uint32_t reserved;
+  eLeapTrackingMode current_tracking_mode;
+} LEAP_TRACKING_MODE_EVENT;
+
+typedef enum _eLeapEventType {
+  eLeapEventType_None = 0,
+  eLeapEventType_Connection,
+  eLeapEventType_ConnectionLost,
+  eLeapEventType_Device,
+  eLeapEventType_DeviceFailure,
+  eLeapEventType_Policy,
+  eLeapEventType_Tracking = 0x100,
+  eLeapEventType_ImageRequestError,
+  eLeapEventType_ImageComplete,
+  eLeapEventType_LogEvent,
+  eLeapEventType_DeviceLost,
+  eLeapEventType_ConfigResponse,
+  eLeapEventType_ConfigChange,
+  eLeapEventType_DeviceStatusChange,
+  eLeapEventType_DroppedFrame,
+  eLeapEventType_Image,
+  eLeapEventType_PointMappingChange,
+  eLeapEventType_TrackingMode,
+  eLeapEventType_LogEvents,
+  eLeapEventType_HeadPose
+} eLeapEventType;
+
+typedef struct _LEAP_CONNECTION_MESSAGE {
+  uint32_t size;
+  eLeapEventType type;
+  union {
+    const void* pointer;
+    const LEAP_CONNECTION_EVENT* connection_event;
+    const LEAP_CONNECTION_LOST_EVENT* connection_lost_event;
+    const LEAP_DEVICE_EVENT* device_event;
+    const LEAP_DEVICE_FAILURE_EVENT* device_failure_event;
+    const LEAP_TRACKING_EVENT* tracking_event;
+    const LEAP_TRACKING_MODE_EVENT* tracking_mode_event;
+  };
+  uint32_t device_id;
+} LEAP_CONNECTION_MESSAGE;
+
+LEAP_EXPORT int64_t LEAP_CALL LeapGetNow(void);
+
+LEAP_EXPORT eLeapRS LEAP_CALL LeapCreateConnection(const LEAP_CONNECTION_CONFIG* pConfig, LEAP_CONNECTION* phConnection);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapOpenConnection(LEAP_CONNECTION hConnection);
+LEAP_EXPORT void LEAP_CALL LeapCloseConnection(LEAP_CONNECTION hConnection);
+LEAP_EXPORT void LEAP_CALL LeapDestroyConnection(LEAP_CONNECTION hConnection);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapPollConnection(LEAP_CONNECTION hConnection, uint32_t timeout, LEAP_CONNECTION_MESSAGE* evt);
+
+LEAP_EXPORT eLeapRS LEAP_CALL LeapSetTrackingMode(LEAP_CONNECTION hConnection, eLeapTrackingMode mode);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapSetTrackingModeEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, eLeapTrackingMode mode);
+
+LEAP_EXPORT eLeapRS LEAP_CALL LeapGetDeviceList(LEAP_CONNECTION hConnection, LEAP_DEVICE_REF* pArray, uint32_t* pnArray);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapOpenDevice(LEAP_DEVICE_REF rDevice, LEAP_DEVICE* phDevice);
+LEAP_EXPORT void LEAP_CALL LeapCloseDevice(LEAP_DEVICE hDevice);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapGetDeviceInfo(LEAP_DEVICE hDevice, LEAP_DEVICE_INFO* info);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapSubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapUnsubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice);
+
+LEAP_EXPORT eLeapRS LEAP_CALL LeapGetFrameSize(LEAP_CONNECTION hConnection, int64_t timestamp, uint64_t* pncbEvent);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapInterpolateTrackingFrame(LEAP_CONNECTION hConnection, int64_t timestamp, LEAP_TRACKING_EVENT* pEvent, uint64_t ncbEvent);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapGetFrameSizeEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, int64_t timestamp, uint64_t* pncbEvent);
+LEAP_EXPORT eLeapRS LEAP_CALL LeapInterpolateTrackingFrameEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, int64_t timestamp, LEAP_TRACKING_EVENT* pEvent, uint64_t ncbEvent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LEAP_C_H */
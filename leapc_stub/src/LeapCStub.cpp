@@ -0,0 +1,799 @@
+// Stand-in LeapC implementation that needs neither the Ultraleap SDK, the tracking service nor
+// a device. Frames come from a scripted synthetic hand, so anything linked against this can be
+// built, run and benchmarked on a headless machine.
+//
+// Behaviour can be steered from the environment:
+//   LEAPC_STUB_FRAMERATE  Tracking frames per second, per device (default 120)
+//   LEAPC_STUB_DEVICES    Number of devices reported (default 1)
+//   LEAPC_STUB_SCRIPT     Comma separated pose:seconds steps, looped. Poses are open, pinch,
+//                         fist, v, rotate and none (no hand in view).
+
+#include "LeapC.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define STUB_DEFAULT_FRAMERATE 120.0f
+#define STUB_DEFAULT_DEVICES 1
+#define STUB_MAX_DEVICES 8
+#define STUB_DEFAULT_SCRIPT "open:3,pinch:0.5,open:2,rotate:0.6,open:2,v:2,open:2,fist:1.5,none:1"
+#define STUB_SERIAL_PREFIX "STUB"
+// Rotations ease in and out over this long so they pass through "almost rotate"
+#define STUB_ROTATE_RAMP_US 150000
+#define STUB_PI 3.14159265358979f
+
+namespace
+{
+
+enum class Pose
+{
+	None,
+	Open,
+	Pinch,
+	Fist,
+	V,
+	Rotate
+};
+
+struct ScriptStep
+{
+	Pose pose;
+	int64_t durationUs;
+};
+
+struct StubSettings
+{
+	float framerate = STUB_DEFAULT_FRAMERATE;
+	uint32_t devices = STUB_DEFAULT_DEVICES;
+	std::vector<ScriptStep> script;
+	int64_t scriptLengthUs = 0;
+};
+
+bool parsePose(const std::string& name, Pose& pose)
+{
+	if (name == "none")        { pose = Pose::None;   return true; }
+	else if (name == "open")   { pose = Pose::Open;   return true; }
+	else if (name == "pinch")  { pose = Pose::Pinch;  return true; }
+	else if (name == "fist")   { pose = Pose::Fist;   return true; }
+	else if (name == "v")      { pose = Pose::V;      return true; }
+	else if (name == "rotate") { pose = Pose::Rotate; return true; }
+	return false;
+}
+
+bool parseScript(const std::string& text, StubSettings& settings)
+{
+	std::stringstream ss(text);
+	std::string step;
+	while (std::getline(ss, step, ','))
+	{
+		size_t colon = step.find(':');
+		ScriptStep parsed;
+		if (colon == std::string::npos || !parsePose(step.substr(0, colon), parsed.pose))
+		{
+			return false;
+		}
+
+		parsed.durationUs = static_cast<int64_t>(std::atof(step.c_str() + colon + 1) * 1e6);
+		if (parsed.durationUs <= 0)
+		{
+			return false;
+		}
+
+		settings.script.push_back(parsed);
+		settings.scriptLengthUs += parsed.durationUs;
+	}
+	return !settings.script.empty();
+}
+
+StubSettings loadSettings()
+{
+	StubSettings settings;
+
+	if (const char* framerate = std::getenv("LEAPC_STUB_FRAMERATE"))
+	{
+		float value = static_cast<float>(std::atof(framerate));
+		if (value > 0.f)
+		{
+			settings.framerate = value;
+		}
+	}
+
+	if (const char* devices = std::getenv("LEAPC_STUB_DEVICES"))
+	{
+		settings.devices = static_cast<uint32_t>(std::min(std::max(std::atoi(devices), 0), STUB_MAX_DEVICES));
+	}
+
+	const char* script = std::getenv("LEAPC_STUB_SCRIPT");
+	if (script == nullptr || !parseScript(script, settings))
+	{
+		if (script != nullptr)
+		{
+			printf("LeapC stub: could not parse LEAPC_STUB_SCRIPT, using the default script.\n");
+		}
+		settings.script.clear();
+		settings.scriptLengthUs = 0;
+		parseScript(STUB_DEFAULT_SCRIPT, settings);
+	}
+
+	return settings;
+}
+
+const StubSettings& settings()
+{
+	static StubSettings loaded = loadSettings();
+	return loaded;
+}
+
+const std::chrono::steady_clock::time_point& clockEpoch()
+{
+	static std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	return epoch;
+}
+
+LEAP_VECTOR vec(float x, float y, float z)
+{
+	LEAP_VECTOR v;
+	v.x = x;
+	v.y = y;
+	v.z = z;
+	return v;
+}
+
+LEAP_VECTOR lerp(const LEAP_VECTOR& a, const LEAP_VECTOR& b, float t)
+{
+	return vec(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+}
+
+// Lay the bones of a digit in a straight line between two points, metacarpal first
+void straightDigit(LEAP_DIGIT& digit, int32_t fingerId, const LEAP_VECTOR& from, const LEAP_VECTOR& to)
+{
+	static const float splits[5] = {0.f, 0.35f, 0.65f, 0.85f, 1.f};
+
+	digit.finger_id = fingerId;
+	for (int b = 0; b < 4; b++)
+	{
+		digit.bones[b].prev_joint = lerp(from, to, splits[b]);
+		digit.bones[b].next_joint = lerp(from, to, splits[b + 1]);
+		digit.bones[b].width = 15.f;
+		digit.bones[b].rotation.x = 0.f;
+		digit.bones[b].rotation.y = 0.f;
+		digit.bones[b].rotation.z = 0.f;
+		digit.bones[b].rotation.w = 1.f;
+	}
+}
+
+// Extended finger: metacarpal from the wrist to the knuckle, then the rest along `direction`
+void extendedDigit(LEAP_DIGIT& digit, int32_t fingerId, const LEAP_VECTOR& knuckle, const LEAP_VECTOR& direction, float length)
+{
+	LEAP_VECTOR wrist = vec(knuckle.x * 0.5f, knuckle.y, knuckle.z + 60.f);
+	LEAP_VECTOR tip = vec(knuckle.x + direction.x * length,
+	                      knuckle.y + direction.y * length,
+	                      knuckle.z + direction.z * length);
+	straightDigit(digit, fingerId, wrist, tip);
+
+	// Put the knuckle where it belongs rather than part way along the straight line
+	digit.metacarpal.next_joint = knuckle;
+	digit.proximal.prev_joint = knuckle;
+	digit.proximal.next_joint = lerp(knuckle, tip, 0.45f);
+	digit.intermediate.prev_joint = digit.proximal.next_joint;
+	digit.intermediate.next_joint = lerp(knuckle, tip, 0.75f);
+	digit.distal.prev_joint = digit.intermediate.next_joint;
+	digit.distal.next_joint = tip;
+}
+
+// Curled finger: the tip folds back under the knuckle
+void curledDigit(LEAP_DIGIT& digit, int32_t fingerId, const LEAP_VECTOR& knuckle)
+{
+	extendedDigit(digit, fingerId, knuckle, vec(0.f, -0.62f, 0.78f), 32.f);
+}
+
+const float KNUCKLE_X[4] = {-28.f, -8.f, 12.f, 30.f};
+const float FINGER_LENGTH[4] = {85.f, 90.f, 85.f, 70.f};
+const float KNUCKLE_Z = -30.f;
+
+// Builds the hand around the origin, fingers towards -z and palm facing -y
+void buildLocalHand(LEAP_HAND& hand, Pose pose)
+{
+	LEAP_VECTOR forward = vec(0.f, 0.f, -1.f);
+	LEAP_VECTOR thumbBase = vec(-25.f, -5.f, 15.f);
+
+	for (int f = 0; f < 4; f++)
+	{
+		LEAP_DIGIT& digit = hand.digits[f + 1];
+		LEAP_VECTOR knuckle = vec(KNUCKLE_X[f], 0.f, KNUCKLE_Z);
+
+		switch (pose)
+		{
+		case Pose::Fist:
+			curledDigit(digit, f + 1, knuckle);
+			break;
+		case Pose::V:
+			if (f < 2)
+			{
+				// Pointing up and away so the fingertips sit above the palm, which scrolls
+				extendedDigit(digit, f + 1, knuckle, vec(0.f, 0.5f, -0.866f), FINGER_LENGTH[f]);
+			}
+			else
+			{
+				curledDigit(digit, f + 1, knuckle);
+			}
+			break;
+		default:
+			extendedDigit(digit, f + 1, knuckle, forward, FINGER_LENGTH[f]);
+			break;
+		}
+		digit.is_extended = pose == Pose::Fist || (pose == Pose::V && f >= 2) ? 0 : 1;
+	}
+
+	switch (pose)
+	{
+	case Pose::Pinch:
+	{
+		// Index tip meets the thumb tip
+		LEAP_VECTOR pinchPoint = vec(-45.f, -15.f, -70.f);
+		straightDigit(hand.thumb, 0, thumbBase, pinchPoint);
+		straightDigit(hand.index, 1, vec(KNUCKLE_X[0] * 0.5f, 0.f, KNUCKLE_Z + 60.f), vec(pinchPoint.x + 2.f, pinchPoint.y, pinchPoint.z));
+		hand.index.proximal.prev_joint = vec(KNUCKLE_X[0], 0.f, KNUCKLE_Z);
+		hand.index.metacarpal.next_joint = hand.index.proximal.prev_joint;
+		break;
+	}
+	case Pose::Fist:
+		straightDigit(hand.thumb, 0, thumbBase, vec(-10.f, -25.f, -20.f));
+		break;
+	case Pose::V:
+		straightDigit(hand.thumb, 0, thumbBase, vec(-40.f, -10.f, -40.f));
+		break;
+	default:
+		straightDigit(hand.thumb, 0, thumbBase, vec(-75.f, 0.f, -78.f));
+		break;
+	}
+	hand.thumb.is_extended = pose == Pose::Fist ? 0 : 1;
+
+	hand.pinch_strength = pose == Pose::Pinch || pose == Pose::Fist ? 1.f : 0.f;
+	hand.grab_strength = pose == Pose::Fist ? 1.f : 0.f;
+	hand.pinch_distance = pose == Pose::Pinch || pose == Pose::Fist ? 2.f : 60.f;
+	hand.grab_angle = pose == Pose::Fist ? STUB_PI : 0.f;
+}
+
+// Rotate about z then move, as a real hand would when turned on its side
+LEAP_VECTOR place(const LEAP_VECTOR& local, float angle, const LEAP_VECTOR& palm)
+{
+	float c = std::cos(angle);
+	float s = std::sin(angle);
+	return vec(local.x * c - local.y * s + palm.x,
+	           local.x * s + local.y * c + palm.y,
+	           local.z + palm.z);
+}
+
+struct ScriptPosition
+{
+	Pose pose;
+	uint32_t loop;
+	int64_t stepStartUs;
+	int64_t stepEndUs;
+	int64_t timeUs;
+};
+
+ScriptPosition scriptPositionAt(int64_t timeUs)
+{
+	const StubSettings& s = settings();
+	ScriptPosition position;
+	int64_t t = timeUs < 0 ? 0 : timeUs;
+	position.loop = static_cast<uint32_t>(t / s.scriptLengthUs);
+	position.timeUs = t % s.scriptLengthUs;
+
+	int64_t start = 0;
+	for (const ScriptStep& step : s.script)
+	{
+		if (position.timeUs < start + step.durationUs)
+		{
+			position.pose = step.pose;
+			position.stepStartUs = start;
+			position.stepEndUs = start + step.durationUs;
+			return position;
+		}
+		start += step.durationUs;
+	}
+
+	position.pose = s.script.back().pose;
+	position.stepStartUs = start - s.script.back().durationUs;
+	position.stepEndUs = start;
+	return position;
+}
+
+// Slow figure-of-eight above the device, offset per device so they don't look identical
+LEAP_VECTOR palmPositionAt(double seconds, uint32_t device)
+{
+	double phase = device * 0.7;
+	return vec(static_cast<float>(80.0 * std::sin(2.0 * STUB_PI * seconds / 4.0 + phase)),
+	           static_cast<float>(200.0 + 50.0 * std::sin(2.0 * STUB_PI * seconds / 3.0 + phase)),
+	           static_cast<float>(20.0 * std::sin(2.0 * STUB_PI * seconds / 5.0 + phase)));
+}
+
+// Number of hands in view at `timestamp`, which is in LeapGetNow time
+uint32_t handsAt(int64_t timestamp, int64_t startUs)
+{
+	if (settings().devices == 0)
+	{
+		return 0;
+	}
+	return scriptPositionAt(timestamp - startUs).pose == Pose::None ? 0 : 1;
+}
+
+void buildHand(LEAP_HAND& hand, int64_t timestamp, int64_t startUs, uint32_t device)
+{
+	ScriptPosition position = scriptPositionAt(timestamp - startUs);
+	double seconds = static_cast<double>(timestamp - startUs) * 1e-6;
+
+	memset(&hand, 0, sizeof(hand));
+	// A new hand every time round the script, like a real hand leaving and coming back
+	hand.id = position.loop * STUB_MAX_DEVICES + device + 1;
+	hand.type = eLeapHandType_Right;
+	hand.confidence = 1.f;
+	hand.visible_time = static_cast<uint64_t>(position.timeUs);
+
+	buildLocalHand(hand, position.pose);
+
+	float angle = 0.f;
+	if (position.pose == Pose::Rotate)
+	{
+		int64_t sinceStart = position.timeUs - position.stepStartUs;
+		int64_t untilEnd = position.stepEndUs - position.timeUs;
+		float ramp = static_cast<float>(std::min(sinceStart, untilEnd)) / STUB_ROTATE_RAMP_US;
+		angle = 0.5f * STUB_PI * std::min(ramp, 1.f);
+	}
+
+	LEAP_VECTOR palm = palmPositionAt(seconds, device);
+	LEAP_VECTOR ahead = palmPositionAt(seconds + 0.001, device);
+
+	for (int d = 0; d < 5; d++)
+	{
+		for (int b = 0; b < 4; b++)
+		{
+			hand.digits[d].bones[b].prev_joint = place(hand.digits[d].bones[b].prev_joint, angle, palm);
+			hand.digits[d].bones[b].next_joint = place(hand.digits[d].bones[b].next_joint, angle, palm);
+		}
+	}
+
+	hand.palm.position = palm;
+	hand.palm.stabilized_position = palm;
+	hand.palm.velocity = vec((ahead.x - palm.x) * 1000.f, (ahead.y - palm.y) * 1000.f, (ahead.z - palm.z) * 1000.f);
+	hand.palm.normal = place(vec(0.f, -1.f, 0.f), angle, vec(0.f, 0.f, 0.f));
+	hand.palm.width = 80.f;
+	hand.palm.direction = vec(0.f, 0.f, -1.f);
+	hand.palm.orientation.w = 1.f;
+
+	hand.arm.prev_joint = place(vec(0.f, 0.f, 250.f), angle, palm);
+	hand.arm.next_joint = place(vec(0.f, 0.f, 40.f), angle, palm);
+	hand.arm.width = 60.f;
+	hand.arm.rotation.w = 1.f;
+}
+
+struct StubDevice
+{
+	uint32_t id;
+	char serial[16];
+};
+
+StubDevice* deviceTable()
+{
+	static StubDevice devices[STUB_MAX_DEVICES];
+	static std::once_flag once;
+	std::call_once(once, []()
+	{
+		for (uint32_t i = 0; i < STUB_MAX_DEVICES; i++)
+		{
+			devices[i].id = i + 1;
+			snprintf(devices[i].serial, sizeof(devices[i].serial), STUB_SERIAL_PREFIX "%04u", i + 1);
+		}
+	});
+	return devices;
+}
+
+struct PendingEvent
+{
+	eLeapEventType type;
+	uint32_t deviceId;
+	int64_t timestamp;
+	int64_t frameId;
+};
+
+}
+
+struct _LEAP_DEVICE
+{
+	uint32_t id;
+};
+
+struct _LEAP_CONNECTION
+{
+	std::mutex mutex;
+	bool open = false;
+	bool multiDeviceAware = false;
+	std::deque<PendingEvent> pending;
+	std::vector<uint32_t> subscribed;
+	eLeapTrackingMode trackingMode = eLeapTrackingMode_Desktop;
+
+	int64_t startUs = 0;
+	int64_t nextFrameUs = 0;
+	int64_t frameId = 0;
+
+	// Messages returned by LeapPollConnection stay valid until the next poll
+	LEAP_CONNECTION_EVENT connectionEvent;
+	LEAP_DEVICE_EVENT deviceEvent;
+	LEAP_TRACKING_MODE_EVENT trackingModeEvent;
+	LEAP_TRACKING_EVENT trackingEvent;
+	LEAP_HAND hands[1];
+};
+
+static void fillTrackingEvent(LEAP_TRACKING_EVENT* event, LEAP_HAND* hands, int64_t timestamp, int64_t frameId,
+                              int64_t startUs, uint32_t device)
+{
+	event->info.reserved = nullptr;
+	event->info.frame_id = frameId;
+	event->info.timestamp = timestamp;
+	event->tracking_frame_id = frameId;
+	event->framerate = settings().framerate;
+	event->nHands = handsAt(timestamp, startUs);
+	event->pHands = hands;
+	if (event->nHands)
+	{
+		buildHand(hands[0], timestamp, startUs, device);
+	}
+}
+
+static void fillMessage(LEAP_CONNECTION hConnection, const PendingEvent& pending, LEAP_CONNECTION_MESSAGE* evt)
+{
+	evt->size = sizeof(LEAP_CONNECTION_MESSAGE);
+	evt->type = pending.type;
+	evt->device_id = pending.deviceId;
+
+	switch (pending.type)
+	{
+	case eLeapEventType_Connection:
+		hConnection->connectionEvent.flags = 0;
+		evt->connection_event = &hConnection->connectionEvent;
+		break;
+	case eLeapEventType_Device:
+		hConnection->deviceEvent.flags = 0;
+		hConnection->deviceEvent.device.handle = &deviceTable()[pending.deviceId - 1];
+		hConnection->deviceEvent.device.id = pending.deviceId;
+		hConnection->deviceEvent.status = eLeapDeviceStatus_Streaming;
+		evt->device_event = &hConnection->deviceEvent;
+		break;
+	case eLeapEventType_TrackingMode:
+		hConnection->trackingModeEvent.reserved = 0;
+		hConnection->trackingModeEvent.current_tracking_mode = hConnection->trackingMode;
+		evt->tracking_mode_event = &hConnection->trackingModeEvent;
+		break;
+	case eLeapEventType_Tracking:
+	default:
+		fillTrackingEvent(&hConnection->trackingEvent, hConnection->hands, pending.timestamp, pending.frameId,
+		                  hConnection->startUs, pending.deviceId - 1);
+		evt->tracking_event = &hConnection->trackingEvent;
+		break;
+	}
+}
+
+extern "C" {
+
+int64_t LEAP_CALL LeapGetNow(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockEpoch()).count();
+}
+
+eLeapRS LEAP_CALL LeapCreateConnection(const LEAP_CONNECTION_CONFIG* pConfig, LEAP_CONNECTION* phConnection)
+{
+	if (phConnection == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	LEAP_CONNECTION connection = new _LEAP_CONNECTION();
+	connection->multiDeviceAware = pConfig != nullptr && (pConfig->flags & eLeapConnectionConfig_MultiDeviceAware);
+	*phConnection = connection;
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapOpenConnection(LEAP_CONNECTION hConnection)
+{
+	if (hConnection == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	std::lock_guard<std::mutex> lock(hConnection->mutex);
+	if (hConnection->open)
+	{
+		return eLeapRS_Success;
+	}
+
+	hConnection->open = true;
+	hConnection->startUs = LeapGetNow();
+	hConnection->nextFrameUs = hConnection->startUs;
+	hConnection->pending.push_back(PendingEvent{eLeapEventType_Connection, 0, 0, 0});
+	for (uint32_t d = 0; d < settings().devices; d++)
+	{
+		hConnection->pending.push_back(PendingEvent{eLeapEventType_Device, d + 1, 0, 0});
+	}
+
+	return eLeapRS_Success;
+}
+
+void LEAP_CALL LeapCloseConnection(LEAP_CONNECTION hConnection)
+{
+	if (hConnection == nullptr)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(hConnection->mutex);
+	hConnection->open = false;
+	hConnection->pending.clear();
+}
+
+void LEAP_CALL LeapDestroyConnection(LEAP_CONNECTION hConnection)
+{
+	delete hConnection;
+}
+
+eLeapRS LEAP_CALL LeapPollConnection(LEAP_CONNECTION hConnection, uint32_t timeout, LEAP_CONNECTION_MESSAGE* evt)
+{
+	if (hConnection == nullptr || evt == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	std::unique_lock<std::mutex> lock(hConnection->mutex);
+	if (!hConnection->open)
+	{
+		return eLeapRS_NotConnected;
+	}
+
+	if (!hConnection->pending.empty())
+	{
+		PendingEvent pending = hConnection->pending.front();
+		hConnection->pending.pop_front();
+		fillMessage(hConnection, pending, evt);
+		return eLeapRS_Success;
+	}
+
+	const int64_t periodUs = static_cast<int64_t>(1e6 / settings().framerate);
+	int64_t waitUs = hConnection->nextFrameUs - LeapGetNow();
+	if (waitUs > 0)
+	{
+		int64_t timeoutUs = static_cast<int64_t>(timeout) * 1000;
+		lock.unlock();
+		std::this_thread::sleep_for(std::chrono::microseconds(std::min(waitUs, timeoutUs)));
+		if (waitUs > timeoutUs)
+		{
+			return eLeapRS_Timeout;
+		}
+		lock.lock();
+	}
+
+	// Frames we were too slow to collect are gone, as they would be from the real service
+	int64_t behind = (LeapGetNow() - hConnection->nextFrameUs) / periodUs;
+	if (behind > 0)
+	{
+		hConnection->nextFrameUs += behind * periodUs;
+		hConnection->frameId += behind;
+	}
+
+	int64_t timestamp = hConnection->nextFrameUs;
+	int64_t frameId = ++hConnection->frameId;
+	hConnection->nextFrameUs += periodUs;
+
+	if (settings().devices == 0 || (hConnection->multiDeviceAware && hConnection->subscribed.empty()))
+	{
+		return eLeapRS_Timeout;
+	}
+
+	// Multi-device aware clients get a frame from every device they subscribed to, others only
+	// hear from the primary device
+	std::vector<uint32_t> sources = hConnection->multiDeviceAware ? hConnection->subscribed : std::vector<uint32_t>{1};
+	for (size_t i = 1; i < sources.size(); i++)
+	{
+		hConnection->pending.push_back(PendingEvent{eLeapEventType_Tracking, sources[i], timestamp, frameId});
+	}
+
+	fillMessage(hConnection, PendingEvent{eLeapEventType_Tracking, sources[0], timestamp, frameId}, evt);
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapSetTrackingMode(LEAP_CONNECTION hConnection, eLeapTrackingMode mode)
+{
+	if (hConnection == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	std::lock_guard<std::mutex> lock(hConnection->mutex);
+	if (!hConnection->open)
+	{
+		return eLeapRS_NotConnected;
+	}
+	hConnection->trackingMode = mode;
+	hConnection->pending.push_back(PendingEvent{eLeapEventType_TrackingMode, 0, 0, 0});
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapSetTrackingModeEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, eLeapTrackingMode mode)
+{
+	if (hDevice == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+	return LeapSetTrackingMode(hConnection, mode);
+}
+
+eLeapRS LEAP_CALL LeapGetDeviceList(LEAP_CONNECTION hConnection, LEAP_DEVICE_REF* pArray, uint32_t* pnArray)
+{
+	if (hConnection == nullptr || pnArray == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	uint32_t count = settings().devices;
+	if (pArray == nullptr)
+	{
+		*pnArray = count;
+		return eLeapRS_Success;
+	}
+
+	if (*pnArray < count)
+	{
+		*pnArray = count;
+		return eLeapRS_InsufficientBuffer;
+	}
+
+	for (uint32_t d = 0; d < count; d++)
+	{
+		pArray[d].handle = &deviceTable()[d];
+		pArray[d].id = d + 1;
+	}
+	*pnArray = count;
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapOpenDevice(LEAP_DEVICE_REF rDevice, LEAP_DEVICE* phDevice)
+{
+	if (phDevice == nullptr || rDevice.id == 0 || rDevice.id > settings().devices)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	*phDevice = new _LEAP_DEVICE{rDevice.id};
+	return eLeapRS_Success;
+}
+
+void LEAP_CALL LeapCloseDevice(LEAP_DEVICE hDevice)
+{
+	delete hDevice;
+}
+
+eLeapRS LEAP_CALL LeapGetDeviceInfo(LEAP_DEVICE hDevice, LEAP_DEVICE_INFO* info)
+{
+	if (hDevice == nullptr || info == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	const StubDevice& device = deviceTable()[hDevice->id - 1];
+	uint32_t needed = static_cast<uint32_t>(strlen(device.serial) + 1);
+
+	info->status = eLeapDeviceStatus_Streaming;
+	info->caps = 0;
+	info->pid = eLeapDevicePID_LMC2;
+	info->baseline = 40;
+	info->h_fov = 2.426f;
+	info->v_fov = 2.426f;
+	info->range = 800000;
+
+	if (info->serial == nullptr || info->serial_length < needed)
+	{
+		info->serial_length = needed;
+		return eLeapRS_InsufficientBuffer;
+	}
+
+	memcpy(info->serial, device.serial, needed);
+	info->serial_length = needed;
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapSubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice)
+{
+	if (hConnection == nullptr || hDevice == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	std::lock_guard<std::mutex> lock(hConnection->mutex);
+	if (std::find(hConnection->subscribed.begin(), hConnection->subscribed.end(), hDevice->id) == hConnection->subscribed.end())
+	{
+		hConnection->subscribed.push_back(hDevice->id);
+	}
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapUnsubscribeEvents(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice)
+{
+	if (hConnection == nullptr || hDevice == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+
+	std::lock_guard<std::mutex> lock(hConnection->mutex);
+	hConnection->subscribed.erase(std::remove(hConnection->subscribed.begin(), hConnection->subscribed.end(), hDevice->id),
+	                              hConnection->subscribed.end());
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapGetFrameSize(LEAP_CONNECTION hConnection, int64_t timestamp, uint64_t* pncbEvent)
+{
+	if (hConnection == nullptr || pncbEvent == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+	if (!hConnection->open)
+	{
+		return eLeapRS_NotConnected;
+	}
+	if (timestamp < hConnection->startUs)
+	{
+		return eLeapRS_TimestampTooEarly;
+	}
+
+	*pncbEvent = sizeof(LEAP_TRACKING_EVENT) + handsAt(timestamp, hConnection->startUs) * sizeof(LEAP_HAND);
+	return eLeapRS_Success;
+}
+
+eLeapRS LEAP_CALL LeapInterpolateTrackingFrame(LEAP_CONNECTION hConnection, int64_t timestamp, LEAP_TRACKING_EVENT* pEvent, uint64_t ncbEvent)
+{
+	// The primary device, as for clients that aren't multi-device aware
+	_LEAP_DEVICE primary{1};
+	return LeapInterpolateTrackingFrameEx(hConnection, &primary, timestamp, pEvent, ncbEvent);
+}
+
+eLeapRS LEAP_CALL LeapGetFrameSizeEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, int64_t timestamp, uint64_t* pncbEvent)
+{
+	if (hDevice == nullptr)
+	{
+		return eLeapRS_InvalidArgument;
+	}
+	// Every device has the same hand in view
+	return LeapGetFrameSize(hConnection, timestamp, pncbEvent);
+}
+
+eLeapRS LEAP_CALL LeapInterpolateTrackingFrameEx(LEAP_CONNECTION hConnection, LEAP_DEVICE hDevice, int64_t timestamp, LEAP_TRACKING_EVENT* pEvent, uint64_t ncbEvent)
+{
+	uint64_t needed = 0;
+	eLeapRS res = LeapGetFrameSizeEx(hConnection, hDevice, timestamp, &needed);
+	if (res != eLeapRS_Success)
+	{
+		return res;
+	}
+	if (pEvent == nullptr || ncbEvent < needed)
+	{
+		return eLeapRS_InsufficientBuffer;
+	}
+
+	// The synthetic hand is a function of time, so any timestamp is an exact sample. The hands
+	// go straight after the event in the caller's buffer, as LeapC lays them out.
+	int64_t period = static_cast<int64_t>(1e6 / settings().framerate);
+	fillTrackingEvent(pEvent, reinterpret_cast<LEAP_HAND*>(pEvent + 1), timestamp,
+	                  (timestamp - hConnection->startUs) / period, hConnection->startUs, hDevice->id - 1);
+	return eLeapRS_Success;
+}
+
+}
@@ -1,58 +1,307 @@
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "ConfigReader.h"
+#include "ConfigWatcher.h"
 #include "MouseControl.h"
+#include "MouseOutputThread.h"
 #include "UltraleapPoller.h"
-#include "MathUtils.h"
+#include "PositionPipeline.h"
 
 #define SECONDS_TO_MICROSECONDS(seconds) seconds * 1000000
 #define METERS_TO_MILLIMETERS(meters) meters * 1000
-#define MILLIMETERS_TO_METERS(millimeteres) millimeteres * 0.001
 
-bool MouseActive = true;
-bool Scrolling = false;
 int directionSwap = 1;
 
-int64_t PrevFistTimestamp;
-int64_t FistStartTimestamp;
-LEAP_VECTOR FistStartPosition;
-bool CancelFistRecentering = false;
 const float FIST_RECENTER_HOLD_TIME_SECONDS = 1.0f;
 const float FIST_RECENTER_DEADZONE_DISTANCE_METERS = 0.03f;
 
-bool CursorDeadzoneEnabled;
-LEAP_VECTOR CursorDeadzoneStartPosition;
 const float CURSOR_DEADZONE_THRESHOLD_METERS = 0.03f;
 
-LEAP_VECTOR PrevPos = {0, 0, 0};
+// With a negative PredictionLeadMs, predict ahead by the measured latency, updated this often
+const uint64_t PREDICTION_LEAD_UPDATE_FRAMES = 120;
 
-void SetMouseActive(bool active)
-{
-	MouseActive = active;
-}
+// How long to wait for devices to turn up when the config asks for all of them
+const uint32_t DEVICE_LIST_TIMEOUT_MS = 2000;
 
-void SetScrolling(bool scrolling)
-{
-	Scrolling = scrolling;
-}
+const char* ReplayPath = nullptr;
+bool ReplayFast = false;
+
+// On latency_clock_us(), for the startup figures in the stats
+int64_t StartTimeUs = 0;
+int64_t ConfigLoadedUs = 0;
 
-bool GetScrolling()
+void printSinceStart(const char* what, const int64_t timeUs)
 {
-	return Scrolling;
+	if (timeUs == 0)
+	{
+		printf("  %s: not yet\n", what);
+	}
+	else
+	{
+		printf("  %s: %.1fms\n", what, static_cast<double>(timeUs - StartTimeUs) / 1000.0);
+	}
 }
 
-void EnableCursorDeadzone(LEAP_VECTOR startPosition)
+// The poller settings that are picked up again when the config file is reloaded. Called from the
+// polling thread between frames once the poller is running.
+void setReloadablePollerSettingsFromConfig(UltraleapPoller& ulp, const ConfigReader& cfg)
 {
-	CursorDeadzoneStartPosition = startPosition;
-	CursorDeadzoneEnabled = true;
+    ulp.SetIndexPinchThreshold(cfg.GetIndexPinchThreshold());
+
+    ulp.SetBounds(UltraleapBounds{cfg.GetBoundsLeftMeters(),
+                                  cfg.GetBoundsRightMeters(),
+                                  cfg.GetBoundsLowerMeters(),
+                                  cfg.GetBoundsUpperMeters(),
+                                  cfg.GetBoundsNearMeters(),
+                                  cfg.GetBoundsFarMeters(),
+                                  cfg.GetLimitTrackingToWithinBounds()});
+
+	if (cfg.GetPositionFilterActive())
+	{
+		PositionFilterSettings filter;
+		filter.minCutoffHz = cfg.GetFilterMinCutoffHz();
+		filter.beta = cfg.GetFilterBeta();
+		filter.derivativeCutoffHz = 1.0f;
+		// Negative means follow the measured latency, which starts out unknown
+		filter.leadMs = std::max(cfg.GetPredictionLeadMs(), 0.0f);
+		ulp.SetPositionFilter(filter);
+	}
+	else
+	{
+		ulp.ClearPositionFilter();
+	}
 }
 
-void DisableCursorDeadzone()
+// Everything one tracking device drives the mouse with. Each has its own polling thread,
+// gesture state and output thread, so devices share nothing between a frame and its output.
+struct DeviceMouse
 {
-	CursorDeadzoneEnabled = false;
-}
+	// An empty serial takes frames from whichever devices LeapC sends by default
+	DeviceMouse(const std::string& serial, const ConfigWatcher& settings) :
+		ulp(serial.empty() ? new UltraleapPoller() : new UltraleapPoller(serial)),
+		settings(settings)
+	{
+	}
+
+	std::unique_ptr<UltraleapPoller> ulp;
+	const ConfigWatcher& settings;
+	// Tracking callbacks queue their input here rather than injecting it themselves
+	MouseOutputThread output;
+
+	bool mouseActive = true;
+	bool scrolling = false;
+
+	int64_t fistStartTimestamp = 0;
+	LEAP_VECTOR fistStartPosition = {0, 0, 0};
+	bool cancelFistRecentering = false;
+
+	// Off when the cursor and the clicks come from different hands
+	bool useCursorDeadzone = true;
+	bool cursorDeadzoneEnabled = false;
+	LEAP_VECTOR cursorDeadzoneStartPosition = {0, 0, 0};
+
+	LEAP_VECTOR prevPos = {0, 0, 0};
+	PositionPipeline pipeline;
+	// The config generation the pipeline and the reloadable settings come from
+	uint64_t settingsGeneration = UINT64_MAX;
+
+	uint64_t framesSinceLeadUpdate = 0;
+
+	void QueueMouse(MouseCommandType type, float x = 0.f, float y = 0.f)
+	{
+		output.Push(MouseCommand::Of(type, x, y));
+	}
+
+	void EnableCursorDeadzone(LEAP_VECTOR startPosition)
+	{
+		if (!useCursorDeadzone)
+		{
+			return;
+		}
+		cursorDeadzoneStartPosition = startPosition;
+		cursorDeadzoneEnabled = true;
+	}
+
+	void DisableCursorDeadzone()
+	{
+		cursorDeadzoneEnabled = false;
+	}
+
+	// The poller's callbacks, bound to this by setDeviceMouseCallbacks
+	void OnFistStart(const int64_t timestamp, const LEAP_HAND& hand)
+	{
+		mouseActive = false;
+
+		fistStartTimestamp = timestamp;
+		fistStartPosition = hand.palm.position;
+		cancelFistRecentering = false;
+	}
+
+	void OnFistContinue(const int64_t timestamp, const LEAP_HAND& hand)
+	{
+		if (cancelFistRecentering)
+		{
+			return;
+		}
+
+		float distance = ulp->distance(fistStartPosition, hand.palm.position);
+		if (distance > METERS_TO_MILLIMETERS(FIST_RECENTER_DEADZONE_DISTANCE_METERS))
+		{
+			cancelFistRecentering = true;
+		}
+
+		int64_t timeSinceFistStart = timestamp - fistStartTimestamp;
+		if (timeSinceFistStart > SECONDS_TO_MICROSECONDS(FIST_RECENTER_HOLD_TIME_SECONDS))
+		{
+			cancelFistRecentering = true;
+
+			QueueMouse(MouseCommandType::SetFraction, 0.5f, 0.5f);
+		}
+	}
+
+	void OnFistStop(const int64_t, const LEAP_HAND&)
+	{
+		mouseActive = true;
+	}
+
+	void OnIndexPinchStart(const int64_t, const LEAP_HAND& hand)
+	{
+		QueueMouse(MouseCommandType::PrimaryDown);
+		EnableCursorDeadzone(hand.palm.position);
+	}
+
+	void OnIndexPinchStop(const int64_t, const LEAP_HAND&)
+	{
+		QueueMouse(MouseCommandType::PrimaryUp);
+		DisableCursorDeadzone();
+	}
+
+	void OnAlmostRotateStart(const int64_t, const LEAP_HAND& hand)
+	{
+		EnableCursorDeadzone(hand.palm.position);
+	}
+
+	void OnRotateStart(const int64_t, const LEAP_HAND& hand)
+	{
+		QueueMouse(MouseCommandType::SecondaryDown);
+		EnableCursorDeadzone(hand.palm.position);
+	}
+
+	void OnRotateStop(const int64_t, const LEAP_HAND&)
+	{
+		QueueMouse(MouseCommandType::SecondaryUp);
+		DisableCursorDeadzone();
+	}
+
+	void OnVStart(const int64_t, const LEAP_HAND&)
+	{
+		scrolling = true;
+	}
+
+	void OnVContinue(const int64_t, const LEAP_HAND& h)
+	{
+		const ConfigReader& config = settings.Get();
+		float palmToFingertipDist = h.middle.distal.next_joint.y - h.palm.position.y;
+
+		float move = config.GetScrollingSpeed() * directionSwap;
+		float threshold = config.GetScrollThreshold();
+
+		if (palmToFingertipDist > threshold)
+		{
+			QueueMouse(MouseCommandType::Scroll, 0.f, move);
+		}
+		else if (palmToFingertipDist < -threshold)
+		{
+			QueueMouse(MouseCommandType::Scroll, 0.f, -move);
+		}
+	}
+
+	void OnVStop(const int64_t, const LEAP_HAND&)
+	{
+		scrolling = false;
+	}
+
+	// Picks up a reloaded config before the frame's hands are handled
+	void OnFrameStart(const int64_t)
+	{
+		const uint64_t generation = settings.GetGeneration();
+		if (generation == settingsGeneration)
+		{
+			return;
+		}
+		settingsGeneration = generation;
+
+		const ConfigReader& config = settings.Get();
+		setReloadablePollerSettingsFromConfig(*ulp, config);
+		output.SetRefreshRate(config.GetDisplayRefreshRate());
+		pipeline.Configure(config, directionSwap);
+		// Follow the measured latency again straight away rather than from zero
+		framesSinceLeadUpdate = PREDICTION_LEAD_UPDATE_FRAMES;
+	}
+
+	// Everything a frame injects goes out together once the frame has been handled
+	void OnFrameEnd(const int64_t timestamp)
+	{
+		const ConfigReader& config = settings.Get();
+		output.Push(MouseCommand::FrameEnd(ulp->DeviceToHostTimeUs(timestamp), latency_clock_us()));
+
+		if (config.GetPositionFilterActive() && config.GetPredictionLeadMs() < 0.0f
+			&& ++framesSinceLeadUpdate >= PREDICTION_LEAD_UPDATE_FRAMES)
+		{
+			framesSinceLeadUpdate = 0;
+			ulp->SetPredictionLeadTime(output.GetTotalLatencyUs(50.0) * 0.001f);
+		}
+	}
+
+	void OnPosition(LEAP_VECTOR v)
+	{
+		if ((prevPos.x == 0 && prevPos.y == 0 && prevPos.z == 0) || !mouseActive)
+		{
+			// We want to do relative updates so skip this one so we have sensible numbers
+		}
+		else
+		{
+			if (cursorDeadzoneEnabled)
+			{
+				float deadzoneDistance = ulp->distance(cursorDeadzoneStartPosition, v);
+				if (deadzoneDistance > METERS_TO_MILLIMETERS(CURSOR_DEADZONE_THRESHOLD_METERS))
+				{
+					DisableCursorDeadzone();
+				}
+				return;
+			}
+
+			pipeline.Run(v, prevPos, scrolling, output);
+		}
+
+		prevPos = v;
+	}
+
+	void PrintStats() const
+	{
+		if (!ulp->GetDeviceSerial().empty())
+		{
+			printf("Device %s:\n", ulp->GetDeviceSerial().c_str());
+		}
+		const UltraleapStartupStats startup = ulp->GetStartupStats();
+		printf("Startup, from launch:\n");
+		printSinceStart("config loaded", ConfigLoadedUs);
+		printSinceStart("connected", startup.connectedUs);
+		printSinceStart("first frame", startup.firstFrameUs);
+		printSinceStart("first cursor move", output.GetFirstMotionTimeUs());
+		ulp->PrintPollStats();
+		ulp->PrintFrameStats();
+		output.PrintStats();
+	}
+};
 
 bool ParseCommandLine(ConfigReader &config, int argc, char **argv)
 {
@@ -190,6 +439,82 @@ bool ParseCommandLine(ConfigReader &config, int argc, char **argv)
 				}
 			}
 		}
+		else if (strcmp(argv[i], "--mouse-backend") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				config.SetMouseBackend(argv[i + 1]);
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--poll-strategy") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				config.SetPollStrategy(argv[i + 1]);
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--devices") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				config.SetDevices(argv[i + 1]);
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--monitors") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				config.SetMonitors(argv[i + 1]);
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--record") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				config.SetRecordingPath(argv[i + 1]);
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--replay") == 0)
+		{
+			if (i < (argc - 1))
+			{
+				ReplayPath = argv[i + 1];
+			}
+			else
+			{
+				std::cout << "Not enough arguments" << std::endl;
+				return false;
+			}
+		}
+		else if (strcmp(argv[i], "--replay-fast") == 0)
+		{
+			ReplayFast = true;
+		}
 		else if (strcmp(argv[i], "--right-click-active") == 0)
 		{
 			if (i < (argc - 1))
@@ -216,211 +541,221 @@ bool ParseCommandLine(ConfigReader &config, int argc, char **argv)
 
 void setUltraleapPollerFromConfig(UltraleapPoller& ulp, const ConfigReader& cfg)
 {
-    ulp.SetIndexPinchThreshold(cfg.GetIndexPinchThreshold());
-
-    ulp.bounds = UltraleapBounds{cfg.GetBoundsLeftMeters(),
-                                 cfg.GetBoundsRightMeters(),
-                                 cfg.GetBoundsLowerMeters(),
-                                 cfg.GetBoundsUpperMeters(),
-                                 cfg.GetBoundsNearMeters(),
-                                 cfg.GetBoundsFarMeters(),
-                                 cfg.GetLimitTrackingToWithinBounds()};
+    setReloadablePollerSettingsFromConfig(ulp, cfg);
 
     ulp.SetTrackingMode(cfg.GetTrackingMode());
 	if (!ulp.SetHandedness(cfg.GetHandedness()))
 	{
 		printf("Unknown value for handedness, using default.\n");
 	}
-}
 
-int main(int argc, char** argv)
-{
-	printf("%s\n", argv[0]);
-	ConfigReader config;
-	if (!ParseCommandLine(config, argc, argv))
+	if (!ulp.SetPollStrategy(cfg.GetPollStrategy()))
 	{
-		std::cout << "Failed to parse command line properly. Some values may be defaults." << std::endl;
+		printf("Unknown value for poll strategy, using default.\n");
 	}
+	ulp.SetPollTimeout(static_cast<uint32_t>(cfg.GetPollTimeoutMs()));
+	ulp.SetPollSpinTime(static_cast<uint32_t>(cfg.GetPollSpinMicroseconds()));
+	// Negative samples in step with the display
+	ulp.SetSampleRate(cfg.GetSampleRate() < 0.0f ? cfg.GetDisplayRefreshRate() : cfg.GetSampleRate());
 
-    config.print();
-
-	printf("Setting up..\n");
-	UltraleapPoller ulp;
+	// Opening a recording empties it, which would throw away the frames being replayed
+	if (!cfg.GetRecordingPath().empty() && ReplayPath != nullptr)
+	{
+		printf("Not recording while replaying.\n");
+	}
+	else if (!cfg.GetRecordingPath().empty())
+	{
+		// Each device gets a recording of its own
+		std::string path = cfg.GetRecordingPath();
+		if (!ulp.GetDeviceSerial().empty())
+		{
+			path += "." + ulp.GetDeviceSerial();
+		}
+		if (!ulp.StartRecording(path, static_cast<uint64_t>(cfg.GetRecordingCapacityFrames())))
+		{
+			printf("Failed to start recording, continuing without it.\n");
+		}
+	}
+}
 
-    setUltraleapPollerFromConfig(ulp, config);
-	if (config.GetTrackingMode() == "screentop")
+std::vector<std::string> splitList(const std::string& list)
+{
+	std::vector<std::string> items;
+	std::stringstream ss(list);
+	std::string item;
+	while (std::getline(ss, item, ','))
 	{
-        directionSwap = -1;
+		if (!item.empty())
+		{
+			items.push_back(item);
+		}
 	}
+	return items;
+}
 
-	if (config.GetFistToLiftActive())
+// Serial numbers of the devices the config asks for. Empty means don't pick a device.
+std::vector<std::string> deviceSerialsFromConfig(const ConfigReader& cfg)
+{
+	std::vector<std::string> serials;
+	const std::string devices = cfg.GetDevices();
+	if (devices.empty())
 	{
-		ulp.SetOnFistStartCallback(
-			[](const int64_t timestamp, const LEAP_HAND &hand)
-			{
-				SetMouseActive(false);
+		return serials;
+	}
 
-				FistStartTimestamp = timestamp;
-				FistStartPosition = hand.palm.position;
-				CancelFistRecentering = false;
+	if (devices == ALL_DEVICES)
+	{
+		serials = UltraleapPoller::ListDeviceSerials(DEVICE_LIST_TIMEOUT_MS);
+		if (serials.empty())
+		{
+			printf("No devices found, using the default device.\n");
+		}
+		return serials;
+	}
 
-				// Double fist to recenter.
-				/*int64_t timeBetweenFists = timestamp - PrevFistTimestamp;
-				if (timeBetweenFists < SECONDS_TO_MICROSECONDS(1))
-				{
-					// Recenter the mouse
-					int w = GetScreenWidth();
-					int h = GetScreenHeight();
-					SetMouse(w / 2, h / 2);
-				}
+	return splitList(devices);
+}
 
-				PrevFistTimestamp = timestamp;*/
-			}
-		);
-		ulp.SetOnFistContinueCallback(
-			[&ulp](const int64_t timestamp, const LEAP_HAND& hand)
-			{
-				if (CancelFistRecentering)
-				{
-					return;
-				}
+// Which monitor each device's absolute positions land on, in the same order as the devices
+std::vector<int> deviceMonitorsFromConfig(const ConfigReader& cfg)
+{
+	std::vector<int> monitors;
+	for (const std::string& monitor : splitList(cfg.GetMonitors()))
+	{
+		monitors.push_back(std::atoi(monitor.c_str()));
+	}
+	return monitors;
+}
 
-				float distance = ulp.distance(FistStartPosition, hand.palm.position);
-				if (distance > METERS_TO_MILLIMETERS(FIST_RECENTER_DEADZONE_DISTANCE_METERS))
-				{
-					CancelFistRecentering = true;
-				}
+// Which callbacks are bound is settled here, from the settings at startup. The callbacks
+// themselves read the latest settings, and OnFrameStart re-applies the reloadable ones.
+// Binds dm's handlers at compile time, so frames call them without a std::function in the way
+#define BindGesture(handler) gesture_callback_t::Bind<DeviceMouse, &DeviceMouse::handler>(dm)
 
-				int64_t timeSinceFistStart = timestamp - FistStartTimestamp;
-				if (timeSinceFistStart > SECONDS_TO_MICROSECONDS(FIST_RECENTER_HOLD_TIME_SECONDS))
-				{
-					CancelFistRecentering = true;
+void setDeviceMouseCallbacks(DeviceMouse& dm)
+{
+	UltraleapPoller& ulp = *dm.ulp;
+	const ConfigReader& config = dm.settings.Get();
 
-					int w = GetScreenWidth();
-					int h = GetScreenHeight();
-					SetMouse(w / 2, h / 2);
-				}
-			}
-		);
-		ulp.SetOnFistStopCallback([](const int64_t timestamp, const LEAP_HAND &) {
-			SetMouseActive(true);
-		});
+	if (config.GetFistToLiftActive())
+	{
+		ulp.SetOnFistStartCallback(BindGesture(OnFistStart));
+		ulp.SetOnFistContinueCallback(BindGesture(OnFistContinue));
+		ulp.SetOnFistStopCallback(BindGesture(OnFistStop));
 	}
 
-	ulp.SetOnIndexPinchStartCallback([](const int64_t timestamp, const LEAP_HAND &hand) {
-		PrimaryDown();
-		EnableCursorDeadzone(hand.palm.position);
-	});
-	ulp.SetOnIndexPinchStopCallback([](const int64_t timestamp, const LEAP_HAND&) {
-		PrimaryUp();
-		DisableCursorDeadzone();
-	});
+	ulp.SetOnIndexPinchStartCallback(BindGesture(OnIndexPinchStart));
+	ulp.SetOnIndexPinchStopCallback(BindGesture(OnIndexPinchStop));
 
-	ulp.SetOnAlmostRotateStartCallback([](const int64_t timestamp, const LEAP_HAND &hand) {
-		EnableCursorDeadzone(hand.palm.position);
-    });
-	ulp.SetOnAlmostRotateStopCallback([](const int64_t timestamp, const LEAP_HAND&) {
-		// Not used
-    });
+	ulp.SetOnAlmostRotateStartCallback(BindGesture(OnAlmostRotateStart));
 
 	if (config.GetRightClickActive())
 	{
-		ulp.SetOnRotateStartCallback([&config](const int64_t timestamp, const LEAP_HAND &hand) {
-			SecondaryDown();
-			EnableCursorDeadzone(hand.palm.position);
-		});
-		ulp.SetOnRotateStopCallback([](const int64_t timestamp, const LEAP_HAND &) {
-			SecondaryUp();
-			DisableCursorDeadzone();
-		});
+		ulp.SetOnRotateStartCallback(BindGesture(OnRotateStart));
+		ulp.SetOnRotateStopCallback(BindGesture(OnRotateStop));
 	}
 
 	if (config.GetScrollingActive())
 	{
-		ulp.SetOnVStartCallback([](const int64_t timestamp, const LEAP_HAND &) {
-			SetScrolling(true);
-		});
-		ulp.SetOnVContinueCallback(
-			[&config](const int64_t timestamp, const LEAP_HAND &h)
-			{
-				float palmToFingertipDist = h.middle.distal.next_joint.y - h.palm.position.y;
+		ulp.SetOnVStartCallback(BindGesture(OnVStart));
+		ulp.SetOnVContinueCallback(BindGesture(OnVContinue));
+		ulp.SetOnVStopCallback(BindGesture(OnVStop));
+	}
 
-				float move = config.GetScrollingSpeed() * directionSwap;
-				float threshold = config.GetScrollThreshold();
+	ulp.SetOnFrameStartCallback(frame_callback_t::Bind<DeviceMouse, &DeviceMouse::OnFrameStart>(dm));
+	ulp.SetOnFrameEndCallback(frame_callback_t::Bind<DeviceMouse, &DeviceMouse::OnFrameEnd>(dm));
+	ulp.SetPositionCallback(position_callback_t::Bind<DeviceMouse, &DeviceMouse::OnPosition>(dm));
 
-				if (palmToFingertipDist > threshold)
-				{
-					VerticalScroll(static_cast<int>(move));
-				}
-				else if (palmToFingertipDist < -threshold)
-				{
-					VerticalScroll(static_cast<int>(-move));
-				}
-			}
-		);
-		ulp.SetOnVStopCallback([](const int64_t timestamp, const LEAP_HAND &) {
-			SetScrolling(false);
-		});
+	// In bimanual mode one hand moves the cursor and the other clicks and scrolls
+	if (config.GetHandedness() == BIMANUAL_HANDED)
+	{
+		const bool leftCursor = config.GetBimanualCursorHand() == LEFT_HANDED;
+		ulp.ClearGestureCallbacks(leftCursor ? HandSideLeft : HandSideRight);
+		ulp.ClearPositionCallback(leftCursor ? HandSideRight : HandSideLeft);
+		dm.useCursorDeadzone = false;
 	}
 
-	ulp.SetPositionCallback([&ulp, &config](LEAP_VECTOR v) {
-		if ((PrevPos.x == 0 && PrevPos.y == 0 && PrevPos.z == 0) || !MouseActive)
+	dm.output.SetRefreshRate(config.GetDisplayRefreshRate());
+}
+
+#undef BindGesture
+
+int main(int argc, char** argv)
+{
+	StartTimeUs = latency_clock_us();
+	printf("%s\n", argv[0]);
+	// The command line wins over the file, including after the file is reloaded
+	ConfigWatcher settings(ConfigReader::DefaultFileName(), [argc, argv](ConfigReader& config) {
+		if (!ParseCommandLine(config, argc, argv))
 		{
-			// We want to do relative updates so skip this one so we have sensible numbers
+			std::cout << "Failed to parse command line properly. Some values may be defaults." << std::endl;
 		}
-		else
-		{
-			if (CursorDeadzoneEnabled)
-			{
-				float deadzoneDistance = ulp.distance(CursorDeadzoneStartPosition, v);
-				if (deadzoneDistance > METERS_TO_MILLIMETERS(CURSOR_DEADZONE_THRESHOLD_METERS))
-				{
-					DisableCursorDeadzone();
-				}
-				return;
-			}
+	});
+	const ConfigReader& config = settings.Get();
+	ConfigLoadedUs = latency_clock_us();
 
-			int xMove = static_cast<int>(config.GetSpeed() * (v.x - PrevPos.x)) * directionSwap;
-			float yMove = (v.y - PrevPos.y) * (config.GetVerticalOrientation() ? -1 : 1) * directionSwap;
+    config.print();
 
-			// if (config.GetUseScrolling() && Scrolling)
-			if (Scrolling && config.GetLockMouseOnScroll())
-			{
-				// VerticalScroll(static_cast<int>(config.GetScrollingSpeed() * yMove));
-			}
-			else
-			{
-				if (config.GetUseAbsoluteMousePosition())
-				{
-					int w = GetScreenWidth();
-					int h = GetScreenHeight();
+	if (!SetMouseBackend(config.GetMouseBackend()))
+	{
+		printf("Unsupported mouse backend, using default.\n");
+	}
 
-					float boundsLower = config.GetBoundsLowerMeters();
-					float boundsUpper = config.GetBoundsUpperMeters();
-					float boundsLeft = config.GetBoundsLeftMeters();
-					float boundsRight = config.GetBoundsRightMeters();
+	printf("Setting up..\n");
+	std::vector<std::string> serials = deviceSerialsFromConfig(config);
+	if (serials.empty())
+	{
+		serials.push_back("");
+	}
 
-					int mouseX = MathUtils::remap(-boundsLeft, boundsRight, 0, w, MILLIMETERS_TO_METERS(v.x));
-					int mouseY = MathUtils::remap(boundsLower, boundsUpper, h, 0, MILLIMETERS_TO_METERS(v.y));
+	const std::vector<int> monitors = deviceMonitorsFromConfig(config);
 
-					//printf("W: %f pos vs %i/%i pixels\n", MILLIMETERS_TO_METERS(v.x), mouseX, w);
-					//printf("H: %f pos vs %i/%i pixels\n\n", MILLIMETERS_TO_METERS(v.y), mouseY, h);
+	std::vector<std::unique_ptr<DeviceMouse>> deviceMice;
+	for (const std::string& serial : serials)
+	{
+		deviceMice.emplace_back(new DeviceMouse(serial, settings));
+		DeviceMouse& dm = *deviceMice.back();
 
-					SetMouse(mouseX, mouseY);
-				}
-				else
-				{
-					MoveMouse(xMove, static_cast<int>(config.GetSpeed() * yMove));
-				}
-			}
+		setUltraleapPollerFromConfig(*dm.ulp, config);
+		setDeviceMouseCallbacks(dm);
+		if (deviceMice.size() <= monitors.size())
+		{
+			dm.output.SetMonitor(monitors[deviceMice.size() - 1]);
+		}
+		dm.output.Start();
+	}
+	if (config.GetTrackingMode() == "screentop")
+	{
+        directionSwap = -1;
+	}
+
+	if (ReplayPath != nullptr)
+	{
+		// A recording holds one device's frames, so only the first device takes part
+		DeviceMouse& dm = *deviceMice.front();
+		UltraleapReplayStats stats;
+		printf("Replaying %s%s\n", ReplayPath, ReplayFast ? " as fast as possible" : "");
+		if (!dm.ulp->ReplayRecording(ReplayPath, !ReplayFast, &stats))
+		{
+			printf("Replay failed\n");
+			return 1;
 		}
+		printf("Replayed %llu frames in %.3fs (%.0f frames/s)\n",
+		       static_cast<unsigned long long>(stats.frames), stats.wallSeconds, stats.framesPerSecond);
+		dm.output.Stop();
+		dm.ulp->PrintFrameStats();
+		dm.output.PrintStats();
+		return 0;
+	}
 
-		PrevPos = v;
-	});
-	
-	ulp.StartPoller();
+	// The pollers connect in the background, so the watcher and the prompt don't wait for the service
+	for (auto& dm : deviceMice)
+	{
+		dm->ulp->StartPoller();
+	}
+	settings.Start();
 	
-	std::cout << "Press \"x\" to quit." << std::endl;
+	std::cout << "Press \"x\" to quit, \"s\" for stats." << std::endl;
 	
 	while (true)
 	{
@@ -430,9 +765,22 @@ int main(int argc, char** argv)
 		{
 			break;
 		}
+		else if (c == 's')
+		{
+			for (const auto& dm : deviceMice)
+			{
+				dm->PrintStats();
+			}
+		}
 	}
 	printf("Quitting\n");
 
-	ulp.StopPoller();
+	settings.Stop();
+	for (auto& dm : deviceMice)
+	{
+		dm->ulp->StopPoller();
+		dm->output.Stop();
+		dm->PrintStats();
+	}
 	return 0;
 }
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Values up to 2^LATENCY_SUB_BUCKET_BITS are counted exactly, above that every power of two is
+// split into that many buckets, so a reported value is within about 3% of the real one
+#define LATENCY_SUB_BUCKET_BITS 5
+// Largest value kept apart from the rest, anything bigger lands in the last bucket (~19 hours in us)
+#define LATENCY_MAX_MAGNITUDE 36
+
+// The host clock latencies are measured on, in microseconds
+inline int64_t latency_clock_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Log-linear histogram of latencies in the style of HdrHistogram. Recording is lock-free and
+// safe from any number of threads; reads are a snapshot and may be a frame or so behind.
+class LatencyHistogram
+{
+    public:
+        static const int SUB_BUCKETS = 1 << LATENCY_SUB_BUCKET_BITS;
+        static const int BUCKET_COUNT = (LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+        LatencyHistogram()
+        {
+            Reset();
+        }
+
+        LatencyHistogram(const LatencyHistogram&) = delete;
+        LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+        // Negative values (e.g. from clocks that disagree a little) count as 0
+        void Record(int64_t valueUs)
+        {
+            if (valueUs < 0)
+            {
+                valueUs = 0;
+            }
+
+            counts_[bucketOf(static_cast<uint64_t>(valueUs))].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+
+            int64_t max = max_.load(std::memory_order_relaxed);
+            while (valueUs > max && !max_.compare_exchange_weak(max, valueUs, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        uint64_t Count() const
+        {
+            return count_.load(std::memory_order_relaxed);
+        }
+
+        int64_t Max() const
+        {
+            return max_.load(std::memory_order_relaxed);
+        }
+
+        // The value `percentile` percent of the samples are at or below, 0 if there are none
+        int64_t Percentile(const double percentile) const
+        {
+            const uint64_t count = Count();
+            if (count == 0)
+            {
+                return 0;
+            }
+
+            uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+            if (rank < 1)
+            {
+                rank = 1;
+            }
+
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKET_COUNT; i++)
+            {
+                seen += counts_[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                {
+                    // Report the top of the bucket, but never more than was actually seen
+                    int64_t value = static_cast<int64_t>(highestInBucket(i));
+                    return value < Max() ? value : Max();
+                }
+            }
+            return Max();
+        }
+
+        // Not atomic as a whole, samples recorded during a reset may or may not survive it
+        void Reset()
+        {
+            for (int i = 0; i < BUCKET_COUNT; i++)
+            {
+                counts_[i].store(0, std::memory_order_relaxed);
+            }
+            count_.store(0, std::memory_order_relaxed);
+            max_.store(0, std::memory_order_relaxed);
+        }
+
+        void Print(const char* name) const
+        {
+            printf("  %s: p50 %lldus, p99 %lldus, p99.9 %lldus, max %lldus over %llu frames\n",
+                   name,
+                   static_cast<long long>(Percentile(50.0)),
+                   static_cast<long long>(Percentile(99.0)),
+                   static_cast<long long>(Percentile(99.9)),
+                   static_cast<long long>(Max()),
+                   static_cast<unsigned long long>(Count()));
+        }
+
+    private:
+        static int bucketOf(const uint64_t value)
+        {
+            if (value < static_cast<uint64_t>(SUB_BUCKETS))
+            {
+                return static_cast<int>(value);
+            }
+
+            int magnitude = LATENCY_SUB_BUCKET_BITS;
+            while (magnitude < LATENCY_MAX_MAGNITUDE && (value >> (magnitude + 1)) != 0)
+            {
+                magnitude++;
+            }
+            if ((value >> (magnitude + 1)) != 0)
+            {
+                return BUCKET_COUNT - 1;
+            }
+
+            // The top LATENCY_SUB_BUCKET_BITS bits below the leading one pick the bucket
+            const uint64_t sub = (value >> (magnitude - LATENCY_SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+            return (magnitude - LATENCY_SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<int>(sub);
+        }
+
+        static uint64_t highestInBucket(const int bucket)
+        {
+            if (bucket < SUB_BUCKETS)
+            {
+                return static_cast<uint64_t>(bucket);
+            }
+
+            const int magnitude = bucket / SUB_BUCKETS + LATENCY_SUB_BUCKET_BITS - 1;
+            const uint64_t sub = static_cast<uint64_t>(bucket % SUB_BUCKETS + SUB_BUCKETS);
+            const int shift = magnitude - LATENCY_SUB_BUCKET_BITS;
+            return ((sub + 1) << shift) - 1;
+        }
+
+    private:
+        std::atomic<uint64_t> counts_[BUCKET_COUNT];
+        std::atomic<uint64_t> count_;
+        std::atomic<int64_t>  max_;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Capacity must be a power of two. Neither side ever blocks or allocates: a push to a full
+// queue fails and it is up to the producer what to do about it.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        // Producer only
+        bool TryPush(const T& item)
+        {
+            const uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - headCache_ == Capacity)
+            {
+                // Only go to the shared counter when the cached one says we're full
+                headCache_ = head_.load(std::memory_order_acquire);
+                if (tail - headCache_ == Capacity)
+                {
+                    return false;
+                }
+            }
+
+            items_[tail & (Capacity - 1)] = item;
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only
+        bool TryPop(T& item)
+        {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            if (head == tailCache_)
+            {
+                tailCache_ = tail_.load(std::memory_order_acquire);
+                if (head == tailCache_)
+                {
+                    return false;
+                }
+            }
+
+            item = items_[head & (Capacity - 1)];
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Exact from either end's own thread when the other is idle, a snapshot otherwise
+        size_t Size() const
+        {
+            const uint64_t tail = tail_.load(std::memory_order_acquire);
+            const uint64_t head = head_.load(std::memory_order_acquire);
+            return static_cast<size_t>(tail - head);
+        }
+
+        bool Empty() const
+        {
+            return Size() == 0;
+        }
+
+        static constexpr size_t capacity()
+        {
+            return Capacity;
+        }
+
+    private:
+        // The two ends on separate cache lines so they don't bounce between cores
+        alignas(64) std::atomic<uint64_t> head_{0};
+        uint64_t tailCache_ = 0;     // Consumer's last look at tail_
+        alignas(64) std::atomic<uint64_t> tail_{0};
+        uint64_t headCache_ = 0;     // Producer's last look at head_
+        alignas(64) T items_[Capacity];
+};
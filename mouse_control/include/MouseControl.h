@@ -1,11 +1,42 @@
 #pragma once
 
+#include <string>
+
+// Uses whichever backend the build picked as the default for this platform
+#define DEFAULT_MOUSE_BACKEND "default"
+
+// Monitors beyond this many are left out of GetMonitorRect
+#define MAX_MONITORS 16
+
+// In screen pixels
+struct MonitorRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Select how input is injected, e.g. "xtest", "xsendevent" or "uinput" on Linux.
+// Not all backends are available everywhere. Returns "true" if we support it.
+bool SetMouseBackend(const std::string& backend);
+
+// Calls made between these on the same thread may be held back and sent together when
+// the frame ends. Outside of a frame every call takes effect straight away.
+void BeginMouseFrame();
+bool EndMouseFrame();
+
 // Move the mouse to specific coordinates on the screen
 bool MoveMouse(int x, int y);
 bool SetMouse(int x, int y);
 
+// The screen and monitor sizes are cached, and only looked up again when the display
+// configuration changes, so they're cheap enough to ask for every frame.
 int GetScreenWidth();
 int GetScreenHeight();
+// The monitors making up the screen, primary first. At least one whenever there's a display.
+int GetMonitorCount();
+// Returns "false" for an index that isn't a monitor
+bool GetMonitorRect(const int index, MonitorRect& rect);
 
 bool PrimaryDown();
 bool PrimaryUp();
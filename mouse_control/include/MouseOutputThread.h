@@ -0,0 +1,159 @@
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Commands waiting for the output thread. Room for several seconds of frames even if the
+// injection backend stalls for a while.
+#define MOUSE_OUTPUT_QUEUE_CAPACITY 1024
+
+// Moves are collected and sent at most once per display refresh (see SetRefreshRate). Whole
+// pixels go out, what's left over is carried into the next one.
+enum class MouseCommandType : uint8_t {
+    Move,           // By x, y pixels, fractions included
+    Set,            // To pixel x, y
+    SetFraction,    // To x, y as fractions of the screen size, 0 to 1
+    PrimaryDown,
+    PrimaryUp,
+    PrimaryClick,
+    SecondaryDown,
+    SecondaryUp,
+    SecondaryClick,
+    Scroll,         // By y, as VerticalScroll()
+    FrameEnd        // Everything before this belongs together, send it
+};
+
+struct MouseCommand {
+    MouseCommandType type;
+    float x;
+    float y;
+    // FrameEnd only, on latency_clock_us(). 0 if not known.
+    int64_t frameTimeUs;    // When the tracking frame was captured
+    int64_t handoffTimeUs;  // When the frame's callbacks handed it over for output
+
+    static MouseCommand Of(const MouseCommandType type, const float x = 0.f, const float y = 0.f)
+    {
+        MouseCommand command;
+        command.type = type;
+        command.x = x;
+        command.y = y;
+        command.frameTimeUs = 0;
+        command.handoffTimeUs = 0;
+        return command;
+    }
+
+    static MouseCommand FrameEnd(const int64_t frameTimeUs, const int64_t handoffTimeUs)
+    {
+        MouseCommand command = Of(MouseCommandType::FrameEnd);
+        command.frameTimeUs = frameTimeUs;
+        command.handoffTimeUs = handoffTimeUs;
+        return command;
+    }
+};
+
+struct MouseOutputStats {
+    uint64_t pushed;
+    uint64_t executed;
+    uint64_t overflows;     // Commands dropped because the queue was full
+    uint64_t failures;      // Commands the backend reported failing
+    uint64_t highWaterMark; // Deepest the queue has been
+    uint64_t motionCommands;   // Move, Set and SetFraction commands received
+    uint64_t motionInjections; // Cursor movements actually sent to the backend
+};
+
+// Runs the mouse injection calls in MouseControl.h on a thread of its own, so that a slow
+// backend can't hold up whoever generates the input. Commands are pushed from one thread only
+// (e.g. the tracking thread) and carried out in order.
+class MouseOutputThread
+{
+    public:
+        MouseOutputThread();
+        ~MouseOutputThread();
+
+        MouseOutputThread(const MouseOutputThread&) = delete;
+        MouseOutputThread& operator=(const MouseOutputThread&) = delete;
+
+        // How often the cursor may be moved, normally the display's refresh rate. Motion arriving
+        // faster than this is added together. 0 sends motion with every frame.
+        void SetRefreshRate(const float hz);
+        // Which monitor SetFraction commands are a fraction of, by GetMonitorRect index.
+        // -1, or a monitor that isn't there, means the whole screen.
+        void SetMonitor(const int index);
+
+        void Start();
+        // Carries out whatever is still queued before returning
+        void Stop();
+
+        // Never blocks. Returns "false", and counts an overflow, if the queue is full.
+        bool Push(const MouseCommand& command);
+
+        MouseOutputStats GetStats() const;
+        // When the cursor was first moved, on latency_clock_us(). 0 until it has been.
+        int64_t GetFirstMotionTimeUs() const;
+        // From a tracking frame being captured to its mouse calls being done, 0 before any frames
+        int64_t GetTotalLatencyUs(const double percentile) const;
+        // Includes the latency percentiles of the output stage and of the whole pipeline
+        void PrintStats() const;
+
+    private:
+        void run();
+        void execute(const MouseCommand& command);
+        void wake();
+
+        // Output thread only
+        void addMotion(const MouseCommand& command);
+        bool hasMotion() const;
+        bool motionDue(const std::chrono::steady_clock::time_point now) const;
+        void sendMotion(const std::chrono::steady_clock::time_point now);
+        // Called once a frame's output has gone to the backend
+        void recordLatency();
+
+    private:
+        SpscQueue<MouseCommand, MOUSE_OUTPUT_QUEUE_CAPACITY> queue_;
+        std::thread thread_;
+        std::atomic<bool> running_{false};
+
+        // The output thread sleeps here once it has run out of work
+        std::mutex sleepMutex_;
+        std::condition_variable sleepCondition_;
+        std::atomic<bool> sleeping_{false};
+
+        std::atomic<uint64_t> pushed_{0};
+        std::atomic<uint64_t> executed_{0};
+        std::atomic<uint64_t> overflows_{0};
+        std::atomic<uint64_t> failures_{0};
+        std::atomic<uint64_t> highWaterMark_{0};
+        std::atomic<uint64_t> motionCommands_{0};
+        std::atomic<uint64_t> motionInjections_{0};
+        std::atomic<int64_t> firstMotionUs_{0};
+
+        std::atomic<int64_t> motionIntervalNs_{0};
+        std::atomic<int> monitor_{-1};
+
+        LatencyHistogram outputLatency_;    // Frame handed over to its mouse calls being done
+        LatencyHistogram totalLatency_;     // Frame captured to its mouse calls being done
+
+        // The oldest frame whose output hasn't gone yet. Owned by the output thread.
+        bool timingPending_ = false;
+        int64_t pendingFrameTimeUs_ = 0;
+        int64_t pendingHandoffTimeUs_ = 0;
+
+        // Motion not yet sent. Owned by the output thread.
+        float pendingX_ = 0.f;
+        float pendingY_ = 0.f;
+        bool targetPending_ = false;
+        int targetX_ = 0;
+        int targetY_ = 0;
+        // Where the last SetMouse put the cursor, so the same spot isn't sent again
+        bool lastTargetValid_ = false;
+        int lastTargetX_ = 0;
+        int lastTargetY_ = 0;
+        std::chrono::steady_clock::time_point lastMotion_;
+};
@@ -1,8 +1,18 @@
+#include <atomic>
+#include <chrono>
 #include <iostream>
 
 #include <string.h>
+#include <linux/input-event-codes.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#ifdef FLEDERMAUS_HAVE_XTEST
+#include <X11/extensions/XTest.h>
+#endif
+#ifdef FLEDERMAUS_HAVE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+#include "LinuxUInput.h"
 #include "MouseControl.h"
 
 #define PRIMARY_BUTTON 1
@@ -11,43 +21,410 @@
 #define SCROLL_UP 4
 #define SCROLL_DOWN 5
 
-Display* displayMain;
+// Don't hammer a dead X server with connection attempts every frame.
+#define RECONNECT_INTERVAL_MS 500
 
-bool MoveMouse(int x, int y)
+#define XSENDEVENT_BACKEND "xsendevent"
+#define XTEST_BACKEND "xtest"
+#define UINPUT_BACKEND "uinput"
+
+#ifndef FLEDERMAUS_DEFAULT_MOUSE_BACKEND
+#ifdef FLEDERMAUS_HAVE_XTEST
+#define FLEDERMAUS_DEFAULT_MOUSE_BACKEND XTEST_BACKEND
+#else
+#define FLEDERMAUS_DEFAULT_MOUSE_BACKEND XSENDEVENT_BACKEND
+#endif
+#endif
+
+enum class LinuxBackend
+{
+	XSendEvent,
+	XTest,
+	UInput
+};
+
+static LinuxBackend backendFromName(const std::string& name)
+{
+	if (name == XTEST_BACKEND)
+	{
+		return LinuxBackend::XTest;
+	}
+	else if (name == UINPUT_BACKEND)
+	{
+		return LinuxBackend::UInput;
+	}
+	return LinuxBackend::XSendEvent;
+}
+
+// Written by whoever configures us, read by whichever thread injects input.
+static std::atomic<LinuxBackend> selectedBackend(backendFromName(FLEDERMAUS_DEFAULT_MOUSE_BACKEND));
+
+// Between BeginMouseFrame and EndMouseFrame we leave flushing to EndMouseFrame
+static thread_local bool inFrame = false;
+
+static bool useUInput()
+{
+	return selectedBackend == LinuxBackend::UInput;
+}
+
+static void flush(Display *display)
+{
+	if (!inFrame)
+	{
+		XFlush(display);
+	}
+}
+
+struct ScreenGeometry
+{
+	int width = 0;
+	int height = 0;
+	int monitorCount = 0;
+	MonitorRect monitors[MAX_MONITORS];
+};
+
+// Xlib is not thread safe unless XInitThreads is called, so rather than sharing one
+// Display between threads each thread that injects input owns its own connection.
+// The connection is opened on first use, kept for the lifetime of the thread and
+// re-opened if the X server goes away. It also keeps the screen's geometry, which is
+// only asked for again when XRandR reports a change.
+class X11Connection
+{
+	public:
+		X11Connection() {}
+		~X11Connection()
+		{
+			close();
+		}
+
+		Display* Get()
+		{
+			if (display_ != nullptr && !lost_)
+			{
+				return display_;
+			}
+
+			if (lost_)
+			{
+				std::cout << "Lost connection to the X server, reconnecting." << std::endl;
+				close();
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (attempted_ && now - lastAttempt_ < std::chrono::milliseconds(RECONNECT_INTERVAL_MS))
+			{
+				return nullptr;
+			}
+			attempted_ = true;
+			lastAttempt_ = now;
+
+			display_ = XOpenDisplay(NULL);
+			if (display_ == nullptr)
+			{
+				std::cout << "Could not open main display!" << std::endl;
+				return nullptr;
+			}
+
+#ifdef FLEDERMAUS_HAVE_XIOERROREXITHANDLER
+			XSetIOErrorExitHandler(display_, &X11Connection::onIOError, this);
+#endif
+
+#ifdef FLEDERMAUS_HAVE_XTEST
+			int eventBase, errorBase, major, minor;
+			hasXTest_ = XTestQueryExtension(display_, &eventBase, &errorBase, &major, &minor);
+			if (!hasXTest_ && selectedBackend == LinuxBackend::XTest)
+			{
+				std::cout << "XTest extension not available, falling back to XSendEvent." << std::endl;
+			}
+#endif
+
+#ifdef FLEDERMAUS_HAVE_XRANDR
+			int randrErrorBase;
+			hasXRandR_ = XRRQueryExtension(display_, &randrEventBase_, &randrErrorBase);
+			if (hasXRandR_)
+			{
+				int randrMajor = 0, randrMinor = 0;
+				XRRQueryVersion(display_, &randrMajor, &randrMinor);
+				// XRRGetMonitors arrived in 1.5
+				hasMonitors_ = randrMajor > 1 || (randrMajor == 1 && randrMinor >= 5);
+				XRRSelectInput(display_, DefaultRootWindow(display_),
+				               RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+			}
+#endif
+			geometryDirty_ = true;
+			return display_;
+		}
+
+		// Only valid after a successful Get()
+		bool UseXTest() const
+		{
+			return hasXTest_ && selectedBackend == LinuxBackend::XTest;
+		}
+
+		// Empty if there's no display
+		const ScreenGeometry& Geometry()
+		{
+			Display* display = Get();
+			if (display == nullptr)
+			{
+				geometry_ = ScreenGeometry();
+				geometryDirty_ = true;
+				return geometry_;
+			}
+
+			readGeometryEvents(display);
+			if (geometryDirty_)
+			{
+				loadGeometry(display);
+			}
+			return geometry_;
+		}
+
+	private:
+		void readGeometryEvents(Display* display)
+		{
+#ifdef FLEDERMAUS_HAVE_XRANDR
+			if (!hasXRandR_)
+			{
+				return;
+			}
+
+			// Takes whatever the server has already sent, without waiting and without flushing
+			// input that is being held back for the end of a frame
+			while (XEventsQueued(display, QueuedAfterReading) > 0)
+			{
+				XEvent event;
+				XNextEvent(display, &event);
+				if (event.type == randrEventBase_ + RRScreenChangeNotify)
+				{
+					// Brings DisplayWidth and DisplayHeight up to date
+					XRRUpdateConfiguration(&event);
+					geometryDirty_ = true;
+				}
+				else if (event.type == randrEventBase_ + RRNotify)
+				{
+					geometryDirty_ = true;
+				}
+			}
+#else
+			(void)display;
+#endif
+		}
+
+		void loadGeometry(Display* display)
+		{
+			geometryDirty_ = false;
+
+			const int screen = DefaultScreen(display);
+			geometry_.width = DisplayWidth(display, screen);
+			geometry_.height = DisplayHeight(display, screen);
+			geometry_.monitorCount = 0;
+
+#ifdef FLEDERMAUS_HAVE_XRANDR
+			if (hasMonitors_)
+			{
+				int count = 0;
+				XRRMonitorInfo* monitors = XRRGetMonitors(display, RootWindow(display, screen), True, &count);
+				for (int i = 0; i < count && geometry_.monitorCount < MAX_MONITORS; i++)
+				{
+					MonitorRect rect = {monitors[i].x, monitors[i].y, monitors[i].width, monitors[i].height};
+					if (monitors[i].primary)
+					{
+						// Primary first
+						memmove(&geometry_.monitors[1], &geometry_.monitors[0], geometry_.monitorCount * sizeof(MonitorRect));
+						geometry_.monitors[0] = rect;
+					}
+					else
+					{
+						geometry_.monitors[geometry_.monitorCount] = rect;
+					}
+					geometry_.monitorCount++;
+				}
+				if (monitors != nullptr)
+				{
+					XRRFreeMonitors(monitors);
+				}
+			}
+#endif
+
+			// Without XRandR the whole screen is the one monitor
+			if (geometry_.monitorCount == 0)
+			{
+				geometry_.monitors[0] = MonitorRect{0, 0, geometry_.width, geometry_.height};
+				geometry_.monitorCount = 1;
+			}
+		}
+
+		void close()
+		{
+			if (display_ != nullptr)
+			{
+				XCloseDisplay(display_);
+				display_ = nullptr;
+			}
+			lost_ = false;
+			hasXTest_ = false;
+			hasXRandR_ = false;
+			hasMonitors_ = false;
+		}
+
+#ifdef FLEDERMAUS_HAVE_XIOERROREXITHANDLER
+		// Without this Xlib calls exit() when the server connection breaks.
+		static void onIOError(Display*, void* user_data)
+		{
+			static_cast<X11Connection*>(user_data)->lost_ = true;
+		}
+#endif
+
+		Display* display_ = nullptr;
+		bool lost_ = false;
+		bool hasXTest_ = false;
+		bool hasXRandR_ = false;
+		bool hasMonitors_ = false;
+		int randrEventBase_ = 0;
+		ScreenGeometry geometry_;
+		bool geometryDirty_ = true;
+		bool attempted_ = false;
+		std::chrono::steady_clock::time_point lastAttempt_;
+};
+
+static thread_local X11Connection connection;
+
+bool SetMouseBackend(const std::string& backend)
+{
+	std::string name = backend == DEFAULT_MOUSE_BACKEND ? FLEDERMAUS_DEFAULT_MOUSE_BACKEND : backend;
+
+	if (name == XSENDEVENT_BACKEND)
+	{
+		selectedBackend = LinuxBackend::XSendEvent;
+		return true;
+	}
+#ifdef FLEDERMAUS_HAVE_XTEST
+	else if (name == XTEST_BACKEND)
+	{
+		selectedBackend = LinuxBackend::XTest;
+		return true;
+	}
+#endif
+	else if (name == UINPUT_BACKEND)
+	{
+		// Leave the X backend in place if the kernel device isn't there or we can't open it
+		if (!UInputOpen())
+		{
+			return false;
+		}
+		selectedBackend = LinuxBackend::UInput;
+		return true;
+	}
+
+	return false;
+}
+
+void BeginMouseFrame()
+{
+	inFrame = true;
+	if (useUInput())
+	{
+		UInputBeginFrame();
+	}
+}
+
+bool EndMouseFrame()
 {
-	Display *displayMain = XOpenDisplay(NULL);
+	inFrame = false;
+	if (useUInput())
+	{
+		return UInputEndFrame();
+	}
 
-	if (displayMain == NULL)
+	Display *display = connection.Get();
+	if (display == NULL)
 	{
-		std::cout << "Could not open main display!" << std::endl;
 		return false;
 	}
+	XFlush(display);
+	return true;
+}
 
-	XWarpPointer(displayMain, None, None, 0, 0, 0, 0, x, y);
+// XTest injects through the server's own input path, so the event reaches whichever
+// window is under the pointer in a single request and toolkits treat it as real input.
+static bool FakeButton(Display *display, int button, bool press)
+{
+#ifdef FLEDERMAUS_HAVE_XTEST
+	if (0 == XTestFakeButtonEvent(display, button, press ? True : False, CurrentTime))
+	{
+		return false;
+	}
+	flush(display);
+	return true;
+#else
+	(void)display;
+	(void)button;
+	(void)press;
+	return false;
+#endif
+}
 
-	XCloseDisplay(displayMain);
+bool MoveMouse(int x, int y)
+{
+	if (useUInput())
+	{
+		return UInputMove(x, y);
+	}
+
+	Display *display = connection.Get();
+
+	if (display == NULL)
+	{
+		return false;
+	}
+
+#ifdef FLEDERMAUS_HAVE_XTEST
+	if (connection.UseXTest())
+	{
+		XTestFakeRelativeMotionEvent(display, x, y, CurrentTime);
+	}
+	else
+#endif
+	{
+		XWarpPointer(display, None, None, 0, 0, 0, 0, x, y);
+	}
+	flush(display);
 
 	return true;
 }
 
 bool SetMouse(int x, int y)
 {
-	Display *displayMain = XOpenDisplay(NULL);
+	if (useUInput())
+	{
+		return UInputSet(x, y, GetScreenWidth(), GetScreenHeight());
+	}
 
-	if (displayMain == NULL)
+	Display *display = connection.Get();
+
+	if (display == NULL)
 	{
-		std::cout << "Could not open main display!" << std::endl;
 		return false;
 	}
 
-	XWarpPointer(displayMain, None, DefaultRootWindow(displayMain), 0, 0, 0, 0, x, y);
-
-	XCloseDisplay(displayMain);
+#ifdef FLEDERMAUS_HAVE_XTEST
+	if (connection.UseXTest())
+	{
+		// -1 means the screen the pointer is currently on
+		XTestFakeMotionEvent(display, -1, x, y, CurrentTime);
+	}
+	else
+#endif
+	{
+		XWarpPointer(display, None, DefaultRootWindow(display), 0, 0, 0, 0, x, y);
+	}
+	flush(display);
 
 	return true;
 }
 
-bool DoClick(Display *display, int button)
+static bool DoClick(Display *display, int button)
 {
 	XEvent ev;
 	memset(&ev, 0, sizeof(ev));
@@ -76,7 +453,7 @@ bool DoClick(Display *display, int button)
 	{
 			return false;
 	}
-	XFlush(display);
+	flush(display);
 
 	ev.type = ButtonRelease;
 
@@ -89,12 +466,12 @@ bool DoClick(Display *display, int button)
 	{
 			return false;
 	}
-	XFlush(display);
+	flush(display);
 
 	return true;
 }
 
-bool ButtonDown(Display *display, int button) {
+static bool ButtonDown(Display *display, int button) {
 	// TODO: Make this work
 	XEvent ev;
 	memset(&ev, 0, sizeof(ev));
@@ -123,11 +500,12 @@ bool ButtonDown(Display *display, int button) {
 	{
 			return false;
 	}
+	flush(display);
 
 	return true;
 }
 
-bool ButtonUp(Display *display, int button) {
+static bool ButtonUp(Display *display, int button) {
 	// TODO: Make this work
 	XEvent ev;
 	memset(&ev, 0, sizeof(ev));
@@ -156,79 +534,175 @@ bool ButtonUp(Display *display, int button) {
 	{
 			return false;
 	}
+	flush(display);
 
 	return true;
 }
 
 bool PrimaryClick()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = DoClick(displayMain, PRIMARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_LEFT, true) && UInputButton(BTN_LEFT, false);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, PRIMARY_BUTTON, true) && FakeButton(display, PRIMARY_BUTTON, false);
+	}
+	return DoClick(display, PRIMARY_BUTTON);
 }
 
 bool SecondaryClick()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = DoClick(displayMain, SECONDARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_RIGHT, true) && UInputButton(BTN_RIGHT, false);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, SECONDARY_BUTTON, true) && FakeButton(display, SECONDARY_BUTTON, false);
+	}
+	return DoClick(display, SECONDARY_BUTTON);
 }
 
+// Without an X display, e.g. under Wayland, the uinput backend positions the pointer on its
+// own logical screen, which the compositor maps onto the real one
 int GetScreenWidth()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	int w = DisplayWidth(displayMain, DefaultScreen(displayMain));
-	XCloseDisplay(displayMain);
-	return w;
+	const int width = connection.Geometry().width;
+	return width == 0 && useUInput() ? UINPUT_ABS_SIZE : width;
 }
 
 int GetScreenHeight()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	int h = DisplayHeight(displayMain, DefaultScreen(displayMain));
-	XCloseDisplay(displayMain);
-	return h;
+	const int height = connection.Geometry().height;
+	return height == 0 && useUInput() ? UINPUT_ABS_SIZE : height;
+}
+
+int GetMonitorCount()
+{
+	return connection.Geometry().monitorCount;
+}
+
+bool GetMonitorRect(const int index, MonitorRect& rect)
+{
+	const ScreenGeometry& geometry = connection.Geometry();
+	if (index < 0 || index >= geometry.monitorCount)
+	{
+		return false;
+	}
+	rect = geometry.monitors[index];
+	return true;
 }
 
 bool PrimaryDown()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = ButtonDown(displayMain, PRIMARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_LEFT, true);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, PRIMARY_BUTTON, true);
+	}
+	return ButtonDown(display, PRIMARY_BUTTON);
 }
 
 bool PrimaryUp()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = ButtonUp(displayMain, PRIMARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_LEFT, false);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, PRIMARY_BUTTON, false);
+	}
+	return ButtonUp(display, PRIMARY_BUTTON);
 }
 
 bool SecondaryDown()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = ButtonDown(displayMain, SECONDARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_RIGHT, true);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, SECONDARY_BUTTON, true);
+	}
+	return ButtonDown(display, SECONDARY_BUTTON);
 }
 
 bool SecondaryUp()
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = ButtonUp(displayMain, SECONDARY_BUTTON);
-	XCloseDisplay(displayMain);
-	return ret;
+	if (useUInput())
+	{
+		return UInputButton(BTN_RIGHT, false);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	if (connection.UseXTest())
+	{
+		return FakeButton(display, SECONDARY_BUTTON, false);
+	}
+	return ButtonUp(display, SECONDARY_BUTTON);
 }
 
 bool VerticalScroll(int wheelAmt)
 {
-	Display *displayMain = XOpenDisplay(NULL);
-	bool ret = ButtonUp(displayMain, wheelAmt < 0 ? SCROLL_DOWN : SCROLL_UP);
-	ret = ButtonDown(displayMain, wheelAmt < 0 ? SCROLL_DOWN : SCROLL_UP);
-	XCloseDisplay(displayMain);
+	if (useUInput())
+	{
+		// One notch per call, same as the X backends
+		return UInputWheel(wheelAmt < 0 ? -1 : 1);
+	}
+
+	Display *display = connection.Get();
+	if (display == NULL)
+	{
+		return false;
+	}
+	int button = wheelAmt < 0 ? SCROLL_DOWN : SCROLL_UP;
+	if (connection.UseXTest())
+	{
+		// A wheel notch is a press and release of the scroll button
+		return FakeButton(display, button, true) && FakeButton(display, button, false);
+	}
+	bool ret = ButtonUp(display, button);
+	ret = ButtonDown(display, button);
 	return ret;
 }
\ No newline at end of file
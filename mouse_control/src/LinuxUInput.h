@@ -0,0 +1,26 @@
+#pragma once
+
+// Kernel uinput virtual pointer used by LinuxMouseControl.cpp when the "uinput" backend
+// is selected. Events bypass the X server entirely so this also works under Wayland.
+//
+// Events are queued per thread and written, followed by a single EV_SYN, in one write()
+// when the frame ends. Outside of a frame every call is written straight away.
+
+// The absolute device's axes run from 0 to UINPUT_ABS_SIZE - 1 whatever the screen size, and
+// the compositor maps them onto the screen. Without an X display to size the screen from,
+// this is the size of the screen too.
+#define UINPUT_ABS_SIZE 65536
+
+// Creates the virtual device if needed. Returns "false" if /dev/uinput can't be used.
+bool UInputOpen();
+
+bool UInputMove(int dx, int dy);
+// x and y are scaled from a screen of the given size onto the absolute device's axes. The
+// absolute device is created on first use.
+bool UInputSet(int x, int y, int screenWidth, int screenHeight);
+// Ends the report, so a press and release queued in the same frame are seen as a click
+bool UInputButton(int button, bool press);
+bool UInputWheel(int notches);
+
+void UInputBeginFrame();
+bool UInputEndFrame();
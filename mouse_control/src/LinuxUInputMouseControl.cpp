@@ -0,0 +1,326 @@
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/uinput.h>
+
+#include "LinuxUInput.h"
+
+#define UINPUT_PATH "/dev/uinput"
+#define UINPUT_DEVICE_NAME "Fledermaus virtual pointer"
+#define UINPUT_ABS_DEVICE_NAME "Fledermaus virtual absolute pointer"
+#define UINPUT_VENDOR 0x1209
+#define UINPUT_PRODUCT 0xF1ED
+
+// More than enough for one frame's moves, clicks and scrolls. If it does fill up we
+// flush early rather than drop anything.
+#define MAX_EVENTS_PER_FRAME 64
+
+class UInputDevice
+{
+	public:
+		~UInputDevice()
+		{
+			destroy();
+		}
+
+		// Relative device: motion, buttons and wheel
+		bool CreateRelative()
+		{
+			if (fd_ >= 0)
+			{
+				return true;
+			}
+
+			int fd = openUInput();
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0 &&
+			          ioctl(fd, UI_SET_KEYBIT, BTN_LEFT) >= 0 &&
+			          ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT) >= 0 &&
+			          ioctl(fd, UI_SET_KEYBIT, BTN_MIDDLE) >= 0 &&
+			          ioctl(fd, UI_SET_EVBIT, EV_REL) >= 0 &&
+			          ioctl(fd, UI_SET_RELBIT, REL_X) >= 0 &&
+			          ioctl(fd, UI_SET_RELBIT, REL_Y) >= 0 &&
+			          ioctl(fd, UI_SET_RELBIT, REL_WHEEL) >= 0 &&
+			          create(fd, UINPUT_DEVICE_NAME);
+
+			if (!ok)
+			{
+				std::cout << "Could not create uinput device: " << strerror(errno) << std::endl;
+				close(fd);
+				return false;
+			}
+
+			fd_ = fd;
+			return true;
+		}
+
+		// Absolute device: only ever moves the pointer, so it is created on first use
+		bool CreateAbsolute()
+		{
+			if (absFd_ >= 0)
+			{
+				return true;
+			}
+
+			int fd = openUInput();
+			if (fd < 0)
+			{
+				return false;
+			}
+
+			uinput_abs_setup xAxis;
+			memset(&xAxis, 0, sizeof(xAxis));
+			xAxis.code = ABS_X;
+			xAxis.absinfo.maximum = UINPUT_ABS_SIZE - 1;
+
+			uinput_abs_setup yAxis;
+			memset(&yAxis, 0, sizeof(yAxis));
+			yAxis.code = ABS_Y;
+			yAxis.absinfo.maximum = UINPUT_ABS_SIZE - 1;
+
+			// Pointers need at least one button to be treated as a pointer rather than a joystick
+			bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) >= 0 &&
+			          ioctl(fd, UI_SET_KEYBIT, BTN_LEFT) >= 0 &&
+			          ioctl(fd, UI_SET_EVBIT, EV_ABS) >= 0 &&
+			          ioctl(fd, UI_SET_ABSBIT, ABS_X) >= 0 &&
+			          ioctl(fd, UI_SET_ABSBIT, ABS_Y) >= 0 &&
+			          ioctl(fd, UI_ABS_SETUP, &xAxis) >= 0 &&
+			          ioctl(fd, UI_ABS_SETUP, &yAxis) >= 0 &&
+			          create(fd, UINPUT_ABS_DEVICE_NAME);
+
+			if (!ok)
+			{
+				std::cout << "Could not create absolute uinput device: " << strerror(errno) << std::endl;
+				close(fd);
+				return false;
+			}
+
+			absFd_ = fd;
+			return true;
+		}
+
+		int Fd() const
+		{
+			return fd_;
+		}
+
+		int AbsFd() const
+		{
+			return absFd_;
+		}
+
+	private:
+		static int openUInput()
+		{
+			int fd = open(UINPUT_PATH, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+			if (fd < 0)
+			{
+				std::cout << "Could not open " UINPUT_PATH ": " << strerror(errno) << std::endl;
+			}
+			return fd;
+		}
+
+		static bool create(int fd, const char* name)
+		{
+			uinput_setup setup;
+			memset(&setup, 0, sizeof(setup));
+			setup.id.bustype = BUS_VIRTUAL;
+			setup.id.vendor = UINPUT_VENDOR;
+			setup.id.product = UINPUT_PRODUCT;
+			strncpy(setup.name, name, UINPUT_MAX_NAME_SIZE - 1);
+
+			return ioctl(fd, UI_DEV_SETUP, &setup) >= 0 &&
+			       ioctl(fd, UI_DEV_CREATE) >= 0;
+		}
+
+		void destroy()
+		{
+			if (fd_ >= 0)
+			{
+				ioctl(fd_, UI_DEV_DESTROY);
+				close(fd_);
+				fd_ = -1;
+			}
+			if (absFd_ >= 0)
+			{
+				ioctl(absFd_, UI_DEV_DESTROY);
+				close(absFd_);
+				absFd_ = -1;
+			}
+		}
+
+		// Read without the lock by whichever thread injects input
+		std::atomic<int> fd_{-1};
+		std::atomic<int> absFd_{-1};
+};
+
+// The virtual devices are shared by the whole process, the event queues below are not.
+static UInputDevice device;
+static std::mutex deviceMutex;
+
+// Events queued by one thread for one device, written out as a single report.
+class EventBatch
+{
+	public:
+		bool Add(int fd, unsigned short type, unsigned short code, int value)
+		{
+			if (fd_ != fd || count_ == MAX_EVENTS_PER_FRAME - 1)
+			{
+				// Keep room for the EV_SYN
+				if (!Flush())
+				{
+					return false;
+				}
+				fd_ = fd;
+			}
+
+			input_event& ev = events_[count_++];
+			memset(&ev, 0, sizeof(ev));
+			ev.type = type;
+			ev.code = code;
+			ev.value = value;
+			return true;
+		}
+
+		bool Flush()
+		{
+			if (count_ == 0)
+			{
+				return true;
+			}
+
+			input_event& syn = events_[count_++];
+			memset(&syn, 0, sizeof(syn));
+			syn.type = EV_SYN;
+			syn.code = SYN_REPORT;
+
+			size_t bytes = count_ * sizeof(input_event);
+			ssize_t written = write(fd_, events_, bytes);
+			count_ = 0;
+
+			if (written != static_cast<ssize_t>(bytes))
+			{
+				std::cout << "Failed to write uinput events: " << strerror(errno) << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+	private:
+		input_event events_[MAX_EVENTS_PER_FRAME];
+		size_t count_ = 0;
+		int fd_ = -1;
+};
+
+static thread_local EventBatch relBatch;
+static thread_local EventBatch absBatch;
+static thread_local bool inFrame = false;
+
+// From pixels on a screen `size` pixels across to the absolute device's axis
+static int toAbsAxis(int position, int size)
+{
+	if (size <= 1)
+	{
+		return 0;
+	}
+	long long scaled = static_cast<long long>(position) * (UINPUT_ABS_SIZE - 1) / (size - 1);
+	return static_cast<int>(scaled < 0 ? 0 : (scaled > UINPUT_ABS_SIZE - 1 ? UINPUT_ABS_SIZE - 1 : scaled));
+}
+
+static bool finish(EventBatch& batch, bool queued)
+{
+	if (!queued)
+	{
+		return false;
+	}
+	return inFrame || batch.Flush();
+}
+
+bool UInputOpen()
+{
+	std::lock_guard<std::mutex> lock(deviceMutex);
+	return device.CreateRelative();
+}
+
+bool UInputMove(int dx, int dy)
+{
+	int fd = device.Fd();
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	bool queued = true;
+	if (dx != 0)
+	{
+		queued = relBatch.Add(fd, EV_REL, REL_X, dx);
+	}
+	if (dy != 0)
+	{
+		queued = queued && relBatch.Add(fd, EV_REL, REL_Y, dy);
+	}
+	return finish(relBatch, queued);
+}
+
+bool UInputSet(int x, int y, int screenWidth, int screenHeight)
+{
+	if (device.AbsFd() < 0)
+	{
+		std::lock_guard<std::mutex> lock(deviceMutex);
+		if (!device.CreateAbsolute())
+		{
+			return false;
+		}
+	}
+
+	int fd = device.AbsFd();
+	bool queued = absBatch.Add(fd, EV_ABS, ABS_X, toAbsAxis(x, screenWidth)) &&
+	              absBatch.Add(fd, EV_ABS, ABS_Y, toAbsAxis(y, screenHeight));
+	return finish(absBatch, queued);
+}
+
+bool UInputButton(int button, bool press)
+{
+	int fd = device.Fd();
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	// evdev drops a press and release of the same button within one report, so a button
+	// change always ends the report, inside a frame or not
+	return relBatch.Add(fd, EV_KEY, button, press ? 1 : 0) && relBatch.Flush();
+}
+
+bool UInputWheel(int notches)
+{
+	int fd = device.Fd();
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	return finish(relBatch, relBatch.Add(fd, EV_REL, REL_WHEEL, notches));
+}
+
+void UInputBeginFrame()
+{
+	inFrame = true;
+}
+
+bool UInputEndFrame()
+{
+	inFrame = false;
+	bool ok = absBatch.Flush();
+	return relBatch.Flush() && ok;
+}
@@ -0,0 +1,423 @@
+#include "MouseOutputThread.h"
+#include "MouseControl.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// After running out of commands, keep looking for this long before going to sleep. Commands
+// for one frame arrive in a burst, so this saves waking the thread for each of them.
+#define OUTPUT_SPIN_US 50
+// Upper bound on a sleep, in case a wake-up is ever missed
+#define OUTPUT_SLEEP_MS 100
+
+MouseOutputThread::MouseOutputThread()
+{
+}
+
+MouseOutputThread::~MouseOutputThread()
+{
+	Stop();
+}
+
+void MouseOutputThread::SetRefreshRate(const float hz)
+{
+	motionIntervalNs_ = hz > 0.f ? static_cast<int64_t>(1e9 / hz) : 0;
+}
+
+void MouseOutputThread::SetMonitor(const int index)
+{
+	monitor_ = index;
+}
+
+void MouseOutputThread::Start()
+{
+	if (running_)
+	{
+		return;
+	}
+
+	running_ = true;
+	thread_ = std::thread(&MouseOutputThread::run, this);
+}
+
+void MouseOutputThread::Stop()
+{
+	if (!running_)
+	{
+		return;
+	}
+
+	running_ = false;
+	wake();
+	thread_.join();
+}
+
+bool MouseOutputThread::Push(const MouseCommand& command)
+{
+	if (!queue_.TryPush(command))
+	{
+		overflows_.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	pushed_.fetch_add(1, std::memory_order_relaxed);
+
+	// Only this thread writes the mark
+	uint64_t depth = queue_.Size();
+	if (depth > highWaterMark_.load(std::memory_order_relaxed))
+	{
+		highWaterMark_.store(depth, std::memory_order_relaxed);
+	}
+
+	// Pairs with the fence in run(): either we see it asleep, or it sees the command
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleeping_.load(std::memory_order_relaxed))
+	{
+		wake();
+	}
+	return true;
+}
+
+void MouseOutputThread::wake()
+{
+	std::lock_guard<std::mutex> lock(sleepMutex_);
+	sleepCondition_.notify_one();
+}
+
+MouseOutputStats MouseOutputThread::GetStats() const
+{
+	MouseOutputStats stats;
+	stats.pushed = pushed_;
+	stats.executed = executed_;
+	stats.overflows = overflows_;
+	stats.failures = failures_;
+	stats.highWaterMark = highWaterMark_;
+	stats.motionCommands = motionCommands_;
+	stats.motionInjections = motionInjections_;
+	return stats;
+}
+
+int64_t MouseOutputThread::GetFirstMotionTimeUs() const
+{
+	return firstMotionUs_.load(std::memory_order_relaxed);
+}
+
+int64_t MouseOutputThread::GetTotalLatencyUs(const double percentile) const
+{
+	return totalLatency_.Percentile(percentile);
+}
+
+void MouseOutputThread::PrintStats() const
+{
+	MouseOutputStats stats = GetStats();
+	printf("Mouse output: %llu commands queued, %llu carried out, %llu failed\n",
+	       static_cast<unsigned long long>(stats.pushed),
+	       static_cast<unsigned long long>(stats.executed),
+	       static_cast<unsigned long long>(stats.failures));
+	printf("  queue overflows: %llu, deepest queue: %llu of %d\n",
+	       static_cast<unsigned long long>(stats.overflows),
+	       static_cast<unsigned long long>(stats.highWaterMark),
+	       MOUSE_OUTPUT_QUEUE_CAPACITY);
+	printf("  %llu cursor moves sent for %llu motion commands\n",
+	       static_cast<unsigned long long>(stats.motionInjections),
+	       static_cast<unsigned long long>(stats.motionCommands));
+	outputLatency_.Print("frame handed over to mouse calls done");
+	totalLatency_.Print("frame captured to mouse calls done");
+}
+
+void MouseOutputThread::recordLatency()
+{
+	if (!timingPending_)
+	{
+		return;
+	}
+	timingPending_ = false;
+
+	const int64_t now = latency_clock_us();
+	if (pendingHandoffTimeUs_ != 0)
+	{
+		outputLatency_.Record(now - pendingHandoffTimeUs_);
+	}
+	if (pendingFrameTimeUs_ != 0)
+	{
+		totalLatency_.Record(now - pendingFrameTimeUs_);
+	}
+}
+
+void MouseOutputThread::addMotion(const MouseCommand& command)
+{
+	motionCommands_.fetch_add(1, std::memory_order_relaxed);
+
+	switch (command.type)
+	{
+	case MouseCommandType::Move:
+		pendingX_ += command.x;
+		pendingY_ += command.y;
+		break;
+	case MouseCommandType::Set:
+	case MouseCommandType::SetFraction:
+	{
+		float x = command.x;
+		float y = command.y;
+		if (command.type == MouseCommandType::SetFraction)
+		{
+			// Cached by the backend, so no trip to the display server
+			MonitorRect area;
+			if (!GetMonitorRect(monitor_.load(std::memory_order_relaxed), area))
+			{
+				area = MonitorRect{0, 0, GetScreenWidth(), GetScreenHeight()};
+			}
+			x = area.x + x * area.width;
+			y = area.y + y * area.height;
+		}
+		// Anything moved before this is overridden by it
+		targetPending_ = true;
+		targetX_ = static_cast<int>(x);
+		targetY_ = static_cast<int>(y);
+		pendingX_ = 0.f;
+		pendingY_ = 0.f;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+bool MouseOutputThread::hasMotion() const
+{
+	// Less than a pixel waits for more to add to it
+	return targetPending_ || std::fabs(pendingX_) >= 1.f || std::fabs(pendingY_) >= 1.f;
+}
+
+bool MouseOutputThread::motionDue(const std::chrono::steady_clock::time_point now) const
+{
+	return now - lastMotion_ >= std::chrono::nanoseconds(motionIntervalNs_.load(std::memory_order_relaxed));
+}
+
+void MouseOutputThread::sendMotion(const std::chrono::steady_clock::time_point now)
+{
+	bool sent = false;
+
+	if (targetPending_)
+	{
+		targetPending_ = false;
+		if (!lastTargetValid_ || targetX_ != lastTargetX_ || targetY_ != lastTargetY_)
+		{
+			if (!SetMouse(targetX_, targetY_))
+			{
+				failures_.fetch_add(1, std::memory_order_relaxed);
+			}
+			lastTargetValid_ = true;
+			lastTargetX_ = targetX_;
+			lastTargetY_ = targetY_;
+			sent = true;
+		}
+	}
+
+	// Truncating keeps the remainder the same sign as the motion, so it is never over-shot
+	int x = static_cast<int>(pendingX_);
+	int y = static_cast<int>(pendingY_);
+	if (x != 0 || y != 0)
+	{
+		pendingX_ -= static_cast<float>(x);
+		pendingY_ -= static_cast<float>(y);
+		if (!MoveMouse(x, y))
+		{
+			failures_.fetch_add(1, std::memory_order_relaxed);
+		}
+		lastTargetValid_ = false;
+		sent = true;
+	}
+
+	if (sent)
+	{
+		if (motionInjections_.fetch_add(1, std::memory_order_relaxed) == 0)
+		{
+			firstMotionUs_.store(latency_clock_us(), std::memory_order_relaxed);
+		}
+		lastMotion_ = now;
+	}
+}
+
+void MouseOutputThread::execute(const MouseCommand& command)
+{
+	bool ok = true;
+	switch (command.type)
+	{
+	case MouseCommandType::Move:
+	case MouseCommandType::Set:
+	case MouseCommandType::SetFraction:
+		addMotion(command);
+		break;
+	case MouseCommandType::PrimaryDown:
+		ok = PrimaryDown();
+		break;
+	case MouseCommandType::PrimaryUp:
+		ok = PrimaryUp();
+		break;
+	case MouseCommandType::PrimaryClick:
+		ok = PrimaryClick();
+		break;
+	case MouseCommandType::SecondaryDown:
+		ok = SecondaryDown();
+		break;
+	case MouseCommandType::SecondaryUp:
+		ok = SecondaryUp();
+		break;
+	case MouseCommandType::SecondaryClick:
+		ok = SecondaryClick();
+		break;
+	case MouseCommandType::Scroll:
+		ok = VerticalScroll(static_cast<int>(command.y));
+		break;
+	case MouseCommandType::FrameEnd:
+		ok = EndMouseFrame();
+		break;
+	}
+
+	executed_.fetch_add(1, std::memory_order_relaxed);
+	if (!ok)
+	{
+		failures_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void MouseOutputThread::run()
+{
+	MouseCommand command;
+	bool inFrame = false;
+	lastMotion_ = std::chrono::steady_clock::now() - std::chrono::nanoseconds(motionIntervalNs_.load());
+
+	auto beginFrame = [&inFrame]()
+	{
+		if (!inFrame)
+		{
+			BeginMouseFrame();
+			inFrame = true;
+		}
+	};
+
+	while (true)
+	{
+		if (queue_.TryPop(command))
+		{
+			switch (command.type)
+			{
+			case MouseCommandType::Move:
+			case MouseCommandType::Set:
+			case MouseCommandType::SetFraction:
+				// Held back until the display can show it
+				execute(command);
+				break;
+			case MouseCommandType::FrameEnd:
+			{
+				if (!timingPending_)
+				{
+					timingPending_ = true;
+					pendingFrameTimeUs_ = command.frameTimeUs;
+					pendingHandoffTimeUs_ = command.handoffTimeUs;
+				}
+
+				auto now = std::chrono::steady_clock::now();
+				if (hasMotion() && motionDue(now))
+				{
+					beginFrame();
+					sendMotion(now);
+				}
+
+				// Batch everything up to the frame's end, as the backend would on the tracking thread
+				if (inFrame)
+				{
+					execute(command);
+					inFrame = false;
+					recordLatency();
+				}
+				else
+				{
+					// Nothing to send
+					executed_.fetch_add(1, std::memory_order_relaxed);
+					if (!hasMotion())
+					{
+						// Nor anything held back for later, so nothing to time
+						timingPending_ = false;
+					}
+				}
+				break;
+			}
+			default:
+				beginFrame();
+				// Buttons and scrolling happen where the cursor is meant to be by now
+				if (hasMotion())
+				{
+					sendMotion(std::chrono::steady_clock::now());
+				}
+				execute(command);
+				break;
+			}
+			continue;
+		}
+
+		if (running_)
+		{
+			auto spinUntil = std::chrono::steady_clock::now() + std::chrono::microseconds(OUTPUT_SPIN_US);
+			while (queue_.Empty() && running_ && std::chrono::steady_clock::now() < spinUntil)
+			{
+				std::this_thread::yield();
+			}
+			if (!queue_.Empty())
+			{
+				continue;
+			}
+		}
+
+		// Out of work. Send any motion that has come due, and don't leave a half-finished frame
+		// sitting unsent.
+		auto now = std::chrono::steady_clock::now();
+		if (hasMotion() && (motionDue(now) || !running_))
+		{
+			beginFrame();
+			sendMotion(now);
+		}
+
+		if (inFrame)
+		{
+			if (!EndMouseFrame())
+			{
+				failures_.fetch_add(1, std::memory_order_relaxed);
+			}
+			inFrame = false;
+			recordLatency();
+		}
+
+		if (!running_)
+		{
+			// Stop() only returns once everything pushed before it has been carried out
+			if (queue_.Empty())
+			{
+				break;
+			}
+			continue;
+		}
+
+		// Wake up in time for motion still waiting on the refresh interval
+		auto sleepUntil = now + std::chrono::milliseconds(OUTPUT_SLEEP_MS);
+		if (hasMotion())
+		{
+			auto due = lastMotion_ + std::chrono::nanoseconds(motionIntervalNs_.load(std::memory_order_relaxed));
+			if (due < sleepUntil)
+			{
+				sleepUntil = due;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		sleeping_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		sleepCondition_.wait_until(lock, sleepUntil, [this]()
+		{
+			return !queue_.Empty() || !running_;
+		});
+		sleeping_.store(false, std::memory_order_relaxed);
+	}
+}
@@ -1,7 +1,24 @@
 #include <Windows.h>
 #include <WinUser.h>
+#include <cstring>
 #include "MouseControl.h"
 
+bool SetMouseBackend(const std::string& backend)
+{
+	// SendInput is the only backend on Windows
+	return backend == DEFAULT_MOUSE_BACKEND || backend == "sendinput";
+}
+
+void BeginMouseFrame()
+{
+	// SendInput delivers each call immediately, nothing to batch
+}
+
+bool EndMouseFrame()
+{
+	return true;
+}
+
 bool MoveMouse(int x, int y)
 {
 // 	INPUT input;
@@ -36,6 +53,77 @@ int GetScreenHeight()
 	return GetSystemMetrics(SM_CYSCREEN);
 }
 
+struct MonitorList
+{
+	int count = 0;
+	MonitorRect monitors[MAX_MONITORS];
+	// What the desktop looked like when the list was made
+	int desktopMonitors = -1;
+	RECT desktop = {};
+};
+
+static thread_local MonitorList monitorList;
+
+static BOOL CALLBACK AddMonitor(HMONITOR monitor, HDC, LPRECT, LPARAM data)
+{
+	MonitorList* list = reinterpret_cast<MonitorList*>(data);
+	MONITORINFO info = {};
+	info.cbSize = sizeof(info);
+	if (list->count >= MAX_MONITORS || !GetMonitorInfo(monitor, &info))
+	{
+		return TRUE;
+	}
+
+	MonitorRect rect = {info.rcMonitor.left, info.rcMonitor.top,
+	                    info.rcMonitor.right - info.rcMonitor.left, info.rcMonitor.bottom - info.rcMonitor.top};
+	if (info.dwFlags & MONITORINFOF_PRIMARY)
+	{
+		// Primary first
+		memmove(&list->monitors[1], &list->monitors[0], list->count * sizeof(MonitorRect));
+		list->monitors[0] = rect;
+	}
+	else
+	{
+		list->monitors[list->count] = rect;
+	}
+	list->count++;
+	return TRUE;
+}
+
+// GetSystemMetrics is answered locally, so checking whether the desktop changed is cheap.
+// The monitors are only enumerated again when it has.
+static const MonitorList& Monitors()
+{
+	const int desktopMonitors = GetSystemMetrics(SM_CMONITORS);
+	// Position and size of the virtual desktop, rather than its corners
+	RECT desktop = {GetSystemMetrics(SM_XVIRTUALSCREEN), GetSystemMetrics(SM_YVIRTUALSCREEN),
+	                GetSystemMetrics(SM_CXVIRTUALSCREEN), GetSystemMetrics(SM_CYVIRTUALSCREEN)};
+	if (desktopMonitors != monitorList.desktopMonitors || !EqualRect(&desktop, &monitorList.desktop))
+	{
+		monitorList.count = 0;
+		EnumDisplayMonitors(NULL, NULL, &AddMonitor, reinterpret_cast<LPARAM>(&monitorList));
+		monitorList.desktopMonitors = desktopMonitors;
+		monitorList.desktop = desktop;
+	}
+	return monitorList;
+}
+
+int GetMonitorCount()
+{
+	return Monitors().count;
+}
+
+bool GetMonitorRect(const int index, MonitorRect& rect)
+{
+	const MonitorList& list = Monitors();
+	if (index < 0 || index >= list.count)
+	{
+		return false;
+	}
+	rect = list.monitors[index];
+	return true;
+}
+
 bool IssueClick(DWORD flags)
 {
 	INPUT input;
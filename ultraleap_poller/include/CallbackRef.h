@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+template <typename Signature>
+class CallbackRef;
+
+// A callback that doesn't own what it calls: an object pointer and a plain function pointer.
+// Copying one is two pointer copies and calling one is a single indirect call, with nothing
+// allocated and no type erasure beyond that. Whatever it refers to has to outlive it.
+//
+// Either refer to a callable that lives somewhere else:
+//     auto onPinch = [&](const int64_t, const LEAP_HAND&) { ... };
+//     poller.SetOnPinchStartCallback(onPinch);
+// or bind a member function, which is resolved at compile time:
+//     poller.SetOnPinchStartCallback(gesture_callback_t::Bind<Handler, &Handler::OnPinch>(handler));
+template <typename R, typename... Args>
+class CallbackRef<R(Args...)>
+{
+    public:
+        typedef R (*invoke_t)(void*, Args...);
+
+        CallbackRef() = default;
+
+        CallbackRef(std::nullptr_t)
+        {
+        }
+
+        CallbackRef(invoke_t invoke, void* object) :
+            object_(object),
+            invoke_(invoke)
+        {
+        }
+
+        template <typename F, typename = typename std::enable_if<!std::is_same<typename std::remove_const<F>::type, CallbackRef>::value>::type>
+        CallbackRef(F& callable) :
+            object_(const_cast<void*>(static_cast<const void*>(&callable))),
+            invoke_(&invokeCallable<F>)
+        {
+        }
+
+        // A temporary would be gone by the time it's called
+        template <typename F>
+        CallbackRef(const F&& callable) = delete;
+
+        template <typename C, R (C::*Method)(Args...)>
+        static CallbackRef Bind(C& object)
+        {
+            return CallbackRef(&invokeMethod<C, Method>, &object);
+        }
+
+        template <typename C, R (C::*Method)(Args...) const>
+        static CallbackRef Bind(const C& object)
+        {
+            return CallbackRef(&invokeConstMethod<C, Method>, const_cast<C*>(&object));
+        }
+
+        R operator()(Args... args) const
+        {
+            return invoke_(object_, args...);
+        }
+
+        explicit operator bool() const
+        {
+            return invoke_ != nullptr;
+        }
+
+    private:
+        template <typename F>
+        static R invokeCallable(void* object, Args... args)
+        {
+            return (*static_cast<F*>(object))(args...);
+        }
+
+        template <typename C, R (C::*Method)(Args...)>
+        static R invokeMethod(void* object, Args... args)
+        {
+            return (static_cast<C*>(object)->*Method)(args...);
+        }
+
+        template <typename C, R (C::*Method)(Args...) const>
+        static R invokeConstMethod(void* object, Args... args)
+        {
+            return (static_cast<const C*>(object)->*Method)(args...);
+        }
+
+    private:
+        void* object_ = nullptr;
+        invoke_t invoke_ = nullptr;
+};
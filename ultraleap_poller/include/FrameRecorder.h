@@ -0,0 +1,68 @@
+#pragma once
+
+#include <LeapC.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define FRAME_RECORDING_MAGIC 0x4D524446 // "FDRM"
+#define FRAME_RECORDING_VERSION 1
+// Frames with more hands than this only keep the first ones
+#define FRAME_RECORDING_MAX_HANDS 2
+
+// A recording is a file holding this header followed by a ring of fixed-size FrameRecords.
+// Records are overwritten in place with nothing to tell a reader that one changed under it, so
+// only read a recording once the recorder has closed it.
+struct FrameRecordingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t maxHands;
+    uint64_t capacity;   // Records in the ring
+    // Records ever written. The newest is at (writeCount - 1) % capacity.
+    std::atomic<uint64_t> writeCount;
+    uint8_t  reserved[32];
+};
+
+struct FrameRecord {
+    int64_t  timestamp;
+    int64_t  frameId;
+    int64_t  trackingFrameId;
+    float    framerate;
+    uint32_t nHands;
+    LEAP_HAND hands[FRAME_RECORDING_MAX_HANDS];
+};
+
+// Appends tracking frames to a preallocated, memory-mapped ring so that recording can be
+// left on permanently: Record never allocates, never makes a syscall and never waits.
+class FrameRecorder
+{
+    public:
+        FrameRecorder();
+        ~FrameRecorder();
+
+        FrameRecorder(const FrameRecorder&) = delete;
+        FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+        // Creates (or overwrites) the file, sizes it for `capacity` records and maps it.
+        bool Open(const std::string& path, uint64_t capacity);
+        void Close();
+        bool IsOpen() const;
+
+        void Record(const LEAP_TRACKING_EVENT* tracking_event);
+
+        uint64_t RecordedFrames() const;
+
+    private:
+        FrameRecordingHeader* header_ = nullptr;
+        FrameRecord* records_ = nullptr;
+        size_t mappedSize_ = 0;
+
+#ifdef WIN32
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+};
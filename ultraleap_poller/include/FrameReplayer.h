@@ -0,0 +1,40 @@
+#pragma once
+
+#include "FrameRecorder.h"
+
+#include <cstdint>
+#include <string>
+
+// Read-only view of a recording made by FrameRecorder, oldest frame first. The recording must
+// not still be being written.
+class FrameReplayer
+{
+    public:
+        FrameReplayer();
+        ~FrameReplayer();
+
+        FrameReplayer(const FrameReplayer&) = delete;
+        FrameReplayer& operator=(const FrameReplayer&) = delete;
+
+        bool Open(const std::string& path);
+        void Close();
+        bool IsOpen() const;
+
+        uint64_t FrameCount() const;
+        // 0 is the oldest frame still in the ring
+        const FrameRecord& Frame(const uint64_t index) const;
+
+    private:
+        const FrameRecordingHeader* header_ = nullptr;
+        const FrameRecord* records_ = nullptr;
+        size_t mappedSize_ = 0;
+        uint64_t first_ = 0;
+        uint64_t count_ = 0;
+
+#ifdef WIN32
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#else
+        int fd_ = -1;
+#endif
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <LeapC.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One bit per UltraleapPoller gesture test in the masks ClassifyGestureBatch writes
+#define GESTURE_BIT_ALMOST_PINCH  (1u << 0)
+#define GESTURE_BIT_PINCH         (1u << 1)
+#define GESTURE_BIT_INDEX_PINCH   (1u << 2)
+#define GESTURE_BIT_MIDDLE_PINCH  (1u << 3)
+#define GESTURE_BIT_RING_PINCH    (1u << 4)
+#define GESTURE_BIT_PINKY_PINCH   (1u << 5)
+#define GESTURE_BIT_FIST          (1u << 6)
+#define GESTURE_BIT_V             (1u << 7)
+#define GESTURE_BIT_ALMOST_ROTATE (1u << 8)
+#define GESTURE_BIT_ROTATE        (1u << 9)
+
+// The hand measurements the gesture tests read, each stored as its own contiguous array
+enum GestureBatchChannel {
+    BATCH_THUMB_TIP_X, BATCH_THUMB_TIP_Y, BATCH_THUMB_TIP_Z,
+    BATCH_INDEX_TIP_X, BATCH_INDEX_TIP_Y, BATCH_INDEX_TIP_Z,
+    BATCH_MIDDLE_TIP_X, BATCH_MIDDLE_TIP_Y, BATCH_MIDDLE_TIP_Z,
+    BATCH_RING_TIP_X, BATCH_RING_TIP_Y, BATCH_RING_TIP_Z,
+    BATCH_PINKY_TIP_X, BATCH_PINKY_TIP_Y, BATCH_PINKY_TIP_Z,
+    // Start of the distal bones, which run to the tips above
+    BATCH_INDEX_DISTAL_X, BATCH_INDEX_DISTAL_Y, BATCH_INDEX_DISTAL_Z,
+    BATCH_MIDDLE_DISTAL_X, BATCH_MIDDLE_DISTAL_Y, BATCH_MIDDLE_DISTAL_Z,
+    BATCH_PINKY_DISTAL_X, BATCH_PINKY_DISTAL_Y, BATCH_PINKY_DISTAL_Z,
+    // Start of the proximal bones
+    BATCH_INDEX_KNUCKLE_X, BATCH_INDEX_KNUCKLE_Z,
+    BATCH_PINKY_KNUCKLE_X, BATCH_PINKY_KNUCKLE_Z,
+    BATCH_PINCH_STRENGTH,
+    BATCH_GRAB_STRENGTH,
+    BATCH_CHANNEL_COUNT
+};
+
+// Thresholds as the gesture tests apply them, see UltraleapPoller::GetGestureThresholds()
+struct GestureThresholds {
+    float almostPinchLower;  // Pinch strength must be above this...
+    float pinch;             // ...and below this for an almost pinch, above it for a pinch
+    float indexPinchSq;      // Squared thumb to fingertip distances, in mm^2
+    float middlePinchSq;
+    float ringPinchSq;
+    float pinkyPinchSq;
+    float fist;              // Grab strength
+    float vCos;              // Index and middle distal bones at least this parallel
+    float rotationSq;        // Squared knuckle spread, in mm^2
+    float almostRotationSq;
+};
+
+// Raw pointers to a batch's channels, all `size` long
+struct GestureBatchView {
+    const float* channels[BATCH_CHANNEL_COUNT];
+    size_t size;
+};
+
+enum class GestureBatchKernel {
+    Auto,   // Fastest the CPU supports
+    Scalar,
+    SSE,
+    AVX2
+};
+
+// Many frames' hands in structure-of-arrays form, for classifying whole recordings at once
+class GestureFrameBatch
+{
+    public:
+        void Reserve(const size_t frames);
+        void Clear();
+        void Add(const LEAP_HAND& hand);
+
+        size_t Size() const;
+        GestureBatchView View() const;
+
+    private:
+        std::vector<float> channels_[BATCH_CHANNEL_COUNT];
+};
+
+// Writes a mask of GESTURE_BIT_* per frame to `masks`, which must hold batch.Size() entries.
+// Every kernel gives exactly the same results as the poller's own tests. These are the raw test
+// results: unlike the poller, nothing is suppressed while a fist is being made.
+void ClassifyGestureBatch(const GestureFrameBatch& batch, const GestureThresholds& thresholds, uint16_t* masks,
+                          const GestureBatchKernel kernel = GestureBatchKernel::Auto);
+
+bool GestureBatchKernelSupported(const GestureBatchKernel kernel);
+GestureBatchKernel BestGestureBatchKernel();
+const char* GestureBatchKernelName(const GestureBatchKernel kernel);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <LeapC.h>
+
+#include <atomic>
+#include <cstdint>
+
+struct PositionFilterSettings {
+    float minCutoffHz;      // Smoothing when the hand is still. Lower damps jitter more.
+    float beta;             // How quickly smoothing backs off as the hand speeds up, per mm/s
+    float derivativeCutoffHz; // Smoothing of the velocity and acceleration estimates
+    float leadMs;           // How far ahead to extrapolate the position. 0 turns prediction off.
+};
+
+// One-Euro filter on the palm position, followed by extrapolating it forward along the filtered
+// velocity and acceleration to make up for the time a frame takes to reach the screen.
+// Used from one thread at a time, except SetLeadTime.
+class PositionFilter
+{
+    public:
+        PositionFilter();
+
+        void SetSettings(const PositionFilterSettings& settings);
+        // May be called from any thread, e.g. as latency measurements come in
+        void SetLeadTime(const float leadMs);
+        float GetLeadTime() const;
+
+        // timestampUs is the frame's LeapC timestamp
+        LEAP_VECTOR Filter(const LEAP_VECTOR& position, const int64_t timestampUs);
+        // Forget the hand's history, e.g. when a different hand is being tracked
+        void Reset();
+
+    private:
+        struct Axis {
+            float raw;          // Last unfiltered value
+            float position;
+            float velocity;
+            float acceleration;
+            float lag;          // How far behind the smoothed position runs at a steady speed, in seconds
+        };
+
+        float filterAxis(Axis& axis, const float value, const float dt) const;
+        float predictAxis(const Axis& axis, const float lead) const;
+
+    private:
+        PositionFilterSettings settings_;
+        std::atomic<float> leadSeconds_{0.f};
+
+        bool primed_ = false;
+        int64_t lastTimestampUs_ = 0;
+        Axis axes_[3];
+};
@@ -1,16 +1,102 @@
 #include <LeapC.h>
 
+#include "CallbackRef.h"
+#include "FrameRecorder.h"
+#include "GestureBatch.h"
+#include "LatencyHistogram.h"
+#include "PositionFilter.h"
+#include "SpscQueue.h"
+
 #include <algorithm>
-#include <functional>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #define LEFT_HANDED "left"
 #define RIGHT_HANDED "right"
 #define BOTH_HANDED "both"
+// Follow a left and a right hand at the same time, each with its own gestures and callbacks
+#define BIMANUAL_HANDED "bimanual"
+
+// Zero-timeout polling in a tight loop. Lowest latency, burns a whole core.
+#define POLL_STRATEGY_BUSY "busy"
+// Block in LeapPollConnection until a message arrives or the timeout expires.
+#define POLL_STRATEGY_BLOCKING "blocking"
+// Spin for a short while after each message, then fall back to blocking.
+#define POLL_STRATEGY_HYBRID "hybrid"
+
+// Device events waiting for the device thread. Plugging devices in and out never gets near it.
+#define DEVICE_EVENT_QUEUE_CAPACITY 64
+
+// Callbacks run on the polling thread for every frame, so they're CallbackRefs rather than
+// std::functions. What they refer to has to outlive the poller, or be cleared first.
+typedef CallbackRef<void(LEAP_VECTOR)> position_callback_t;
+typedef CallbackRef<void(const int64_t, const LEAP_HAND&)> gesture_callback_t;
+typedef CallbackRef<void(const int64_t)> frame_callback_t;
+
+enum class UltraleapPollStrategy {
+    Busy,
+    Blocking,
+    Hybrid
+};
+
+// Measured over the current run of the polling thread
+struct UltraleapPollStats {
+    UltraleapPollStrategy strategy;
+    uint64_t polls;
+    uint64_t messages;
+    uint64_t timeouts;
+    uint64_t errors;
+    double   wallSeconds;
+    double   cpuSeconds;      // CPU time used by the polling thread
+    uint64_t wakeSamples;     // Tracking frames the latency figures below are taken over
+    double   meanWakeLatencyUs; // Frame timestamp to LeapPollConnection returning it
+    int64_t  maxWakeLatencyUs;
+    float    sampleRateHz;    // 0 unless sampling, see SetSampleRate
+    uint64_t samples;         // Frames interpolated and handled while sampling
+    uint64_t sampleFailures;  // Samples LeapC couldn't interpolate, e.g. before any tracking
+};
+
+// Worked out from the frame IDs and timestamps LeapC hands out, since the poller or a replay
+// last started
+struct UltraleapFrameStats {
+    uint64_t processed;     // Tracking frames handled
+    uint64_t dropped;       // Skipped tracking_frame_ids: tracked, but never reached us
+    uint64_t untracked;     // Skipped device frame_ids beyond that: the service never tracked them
+    uint64_t late;          // Reached us more than a frame period after they were captured
+    uint64_t outOfOrder;    // IDs that went backwards, e.g. after a reconnect. Counting restarts there.
+    float    deviceFramerate;    // What LeapC last said it was tracking at
+    double   effectiveFramerate; // Frames we actually handled per second of device time, over the last second
+};
+
+// What LeapC said about a device when it turned up
+struct UltraleapDeviceInfo {
+    uint32_t id;            // Unique to the device for as long as the service runs
+    std::string serial;
+    eLeapDevicePID pid;
+    uint32_t baseline;      // Between the cameras, in micrometres
+    float hFov;             // Radians
+    float vFov;
+    uint32_t range;         // Micrometres
+};
+
+// When the poller got going, on latency_clock_us(). Each is 0 until it has happened.
+struct UltraleapStartupStats {
+    int64_t connectedUs;    // The tracking service said the connection was up
+    int64_t firstFrameUs;   // The first tracking frame came out of LeapPollConnection
+};
 
-typedef std::function<void(LEAP_VECTOR)> position_callback_t;
-typedef std::function<void(const int64_t, const LEAP_HAND&)> gesture_callback_t;
+struct UltraleapReplayStats {
+    uint64_t frames;
+    double   wallSeconds;
+    double   framesPerSecond;
+};
 
 struct UltraleapBounds {
     float leftM;
@@ -22,48 +108,188 @@ struct UltraleapBounds {
     bool  limitTrackingToWithinBounds;
 };
 
+// What the gesture tests look at, worked out once per hand per frame so that tests sharing
+// a measurement don't each recompute it. Distances are squared to save the square roots.
+struct HandFeatures {
+    // Thumb tip to index, middle, ring and pinky tips, in mm^2
+    float thumbTipDistanceSq[4];
+    float pinchStrength;
+    float grabStrength;
+    // Index to pinky knuckle across the palm (x and z only), in mm^2. Small when the hand is on its side.
+    float knuckleSpreadSq;
+    // Between the index and middle distal bones
+    float indexMiddleCos;
+    // Only the sign is used: negative when the pinky is curled back against the index
+    float indexPinkyDot;
+};
+
+enum HandFeatureTip {
+    TIP_INDEX = 0,
+    TIP_MIDDLE,
+    TIP_RING,
+    TIP_PINKY
+};
+
+// Which hand a callback is for. Each side has its own gesture state.
+enum UltraleapHandSide {
+    HandSideLeft = 0,
+    HandSideRight,
+    HandSideCount
+};
+
+// Returns "true" while the hand is making the gesture
+typedef CallbackRef<bool(const LEAP_HAND&, const HandFeatures&)> gesture_test_t;
+
+// Gestures are identified by their index in the registry, which holds at most this many
+#define MAX_GESTURES 64
+// Not tested while a fist is being made, since a fist is also detected as a pinch
+#define GESTURE_FLAG_SUPPRESSED_BY_FIST (1u << 0)
+
+// The built-in gestures, registered in this order so each id matches its GESTURE_BIT_*
+enum UltraleapGesture {
+    GestureAlmostPinch = 0,
+    GesturePinch,
+    GestureIndexPinch,
+    GestureMiddlePinch,
+    GestureRingPinch,
+    GesturePinkyPinch,
+    GestureFist,
+    GestureV,
+    GestureAlmostRotate,
+    GestureRotate,
+    BuiltInGestureCount
+};
+
 class UltraleapPoller
 {
     public:
+        // Takes frames from whichever devices LeapC sends by default
         UltraleapPoller();
+        // Only takes frames from the device with this serial number, on a connection of its own.
+        // One of these per device lets each be polled on its own thread with its own gesture state.
+        explicit UltraleapPoller(const std::string& deviceSerial);
         ~UltraleapPoller();
+
+        // Serial numbers of the devices connected now. Waits up to timeoutMs for them to turn up.
+        static std::vector<std::string> ListDeviceSerials(const uint32_t timeoutMs);
+        // Empty unless constructed for a particular device
+        const std::string& GetDeviceSerial() const;
+        // The devices this connection has heard about and not lost since
+        std::vector<UltraleapDeviceInfo> GetDevices() const;
         
         // Not all modes are supported. Returns "true" if we support it.
         bool SetTrackingMode(const std::string& trackingMode);
         
+        // Connecting to the tracking service happens on the polling thread, so this doesn't wait
+        // for it. If the service isn't there yet, it is tried again until it is.
         void StartPoller();
         void StopPoller();
 
+        // Returns "true" if the strategy is one of the POLL_STRATEGY_* names above.
+        // Takes effect the next time the poller is started.
+        bool SetPollStrategy(const std::string& strategy);
+        // How long blocking and hybrid polling wait in LeapPollConnection
+        void SetPollTimeout(const uint32_t timeoutMs);
+        // How long hybrid polling spins after each message before blocking
+        void SetPollSpinTime(const uint32_t spinMicroseconds);
+        // Instead of handling each tracking frame as it arrives, sample the hands rateHz times a
+        // second with LeapInterpolateTrackingFrame, e.g. at the display's refresh rate, or lower
+        // on a low-power machine. 0 turns it off. Takes effect the next time the poller is started.
+        void SetSampleRate(const float rateHz);
+
+        UltraleapPollStats GetPollStats() const;
+        // Includes the latency percentiles of each stage a frame goes through in here
+        void PrintPollStats() const;
+
+        UltraleapStartupStats GetStartupStats() const;
+
+        UltraleapFrameStats GetFrameStats() const;
+        void PrintFrameStats() const;
+
+        // A LeapC timestamp on the latency_clock_us() clock, or 0 if the clocks haven't been
+        // lined up (e.g. in a fast replay, where frame times are the recorded ones)
+        int64_t DeviceToHostTimeUs(const int64_t deviceTimestampUs) const;
+
+        // Record every tracking frame into a memory-mapped ring of `capacityFrames` frames at `path`.
+        // Only call these while the poller is stopped.
+        bool StartRecording(const std::string& path, const uint64_t capacityFrames);
+        void StopRecording();
+
+        // Feed a recording through the same path as live frames, on the calling thread, instead of
+        // polling LeapC. With realTime the recorded pacing is kept, otherwise frames go through as
+        // fast as they can be handled. Don't call while the poller is running.
+        bool ReplayRecording(const std::string& path, const bool realTime, UltraleapReplayStats* stats = nullptr);
+
         // Fires on each update with a hand
         void SetPositionCallback(position_callback_t callback);
         void ClearPositionCallback();
+        // Only for the hand on one side, e.g. in bimanual mode
+        void SetPositionCallback(const UltraleapHandSide side, position_callback_t callback);
+        void ClearPositionCallback(const UltraleapHandSide side);
+
+        // Smooth, and optionally predict, the position handed to the position callback. Don't call
+        // these while the poller is running, other than from its callbacks.
+        void SetPositionFilter(const PositionFilterSettings& settings);
+        void ClearPositionFilter();
+        // Safe to call while polling, e.g. to follow the measured latency
+        void SetPredictionLeadTime(const float leadMs);
+
+        // Fire before and after all other callbacks for a tracking frame, e.g. to batch output
+        void SetOnFrameStartCallback(frame_callback_t callback);
+        void SetOnFrameEndCallback(frame_callback_t callback);
 
         float distance(const LEAP_VECTOR first, const LEAP_VECTOR second) const;
 
         void SetIndexPinchThreshold(const float thresh);
+        // The thresholds the gesture tests use, for classifying batches of frames the same way
+        GestureThresholds GetGestureThresholds() const;
         bool SetHandedness(const std::string& handedness);
 
-        // float boundsLeftM, boundsRightM, boundsLowerM, boundsUpperM, boundsNearM, boundsFarM;
-        // bool limitTrackingToWithinBounds;
-        UltraleapBounds bounds;
+        // Don't call while the poller is running, other than from its callbacks
+        void SetBounds(const UltraleapBounds& bounds);
+        const UltraleapBounds& GetBounds() const;
 
-// This macro sets up all callback setters and getters, tests, and flags related to a particular gesture..
-// EXCEPT the functions and values actually responsible for detecting the gesture.
+        // Adds a gesture to the registry. It is only tested once it has a callback. Returns its id,
+        // or -1 if the name is taken or the registry is full. Don't call while the poller is running.
+        int RegisterGesture(const std::string& name, gesture_test_t test, const uint32_t flags = 0);
+        // Returns the gesture's id, or -1 if there is no gesture by that name
+        int FindGesture(const std::string& name) const;
+
+        // Pass nullptr to clear. Return "false" for an unknown id. Without a side the callback is
+        // used for either hand.
+        bool SetOnGestureStartCallback(const int gesture, gesture_callback_t callback);
+        bool SetOnGestureContinueCallback(const int gesture, gesture_callback_t callback);
+        bool SetOnGestureStopCallback(const int gesture, gesture_callback_t callback);
+        bool SetOnGestureStartCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback);
+        bool SetOnGestureContinueCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback);
+        bool SetOnGestureStopCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback);
+        // Stops gestures being tested on that side's hand at all
+        void ClearGestureCallbacks(const UltraleapHandSide side);
+
+        // Pieces of the frame handling, run on the calling thread, for timing them on their own
+        // (see benchmarks/). Don't call these while the poller is running.
+        void ExtractHandFeatures(const LEAP_HAND* hand, HandFeatures& features) const;
+        // Runs one gesture's test, callback or not. Returns "false" for an unknown id too.
+        bool TestGesture(const int gesture, const LEAP_HAND& hand, const HandFeatures& features) const;
+        // The checks made on a followed hand: features extracted, every gesture with a callback tested
+        void CheckGestures(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand);
+        // Handles the frame as if LeapPollConnection had returned it at receivedUs, on latency_clock_us()
+        void HandleTrackingFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs);
+
+// This macro sets up the callback setters for a built-in gesture, and declares its test.
 #define AddGestureCallbackSetters(name) \
         public: \
         void SetOn##name##StartCallback(gesture_callback_t callback); \
         void SetOn##name##ContinueCallback(gesture_callback_t callback); \
         void SetOn##name##StopCallback(gesture_callback_t callback); \
+        void SetOn##name##StartCallback(const UltraleapHandSide side, gesture_callback_t callback); \
+        void SetOn##name##ContinueCallback(const UltraleapHandSide side, gesture_callback_t callback); \
+        void SetOn##name##StopCallback(const UltraleapHandSide side, gesture_callback_t callback); \
         void ClearOn##name##StartCallback(); \
         void ClearOn##name##ContinueCallback(); \
         void ClearOn##name##StopCallback(); \
         private: \
-        gesture_callback_t name##StartCallback_; \
-        gesture_callback_t name##ContinueCallback_; \
-        gesture_callback_t name##StopCallback_; \
-        bool doing##name##_ = false; \
-        void name##Checks(const int64_t timestamp, const LEAP_HAND* hand); \
-        bool is##name(const LEAP_HAND* hand) const; \
+        bool is##name(const HandFeatures& features) const; \
 
         AddGestureCallbackSetters(AlmostPinch);
         AddGestureCallbackSetters(Pinch);
@@ -77,16 +303,94 @@ class UltraleapPoller
         AddGestureCallbackSetters(Rotate);
 
     private:
+        // Returns "false", with nothing left open, if LeapC couldn't make the connection
+        bool openConnection();
+        // Keeps trying until connected or the poller is stopped. Returns "true" once connected.
+        bool connectWithRetry();
+        void applyTrackingMode();
         void runPoller();
+        uint32_t nextPollTimeout(const std::chrono::steady_clock::time_point& lastMessage) const;
+        void updatePollCpuTime();
+        void resetFrameCounters();
+        // Gap, lateness and framerate accounting for one tracking frame. frameTimeUs is 0 if unknown.
+        void countFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs, const int64_t frameTimeUs);
+        // Works out the offset between LeapGetNow and latency_clock_us
+        void syncDeviceClock();
         LEAP_VECTOR difference(const LEAP_VECTOR first, const LEAP_VECTOR second) const;
         float dot(const LEAP_VECTOR first, const LEAP_VECTOR second) const;
-        float magnitude(const LEAP_VECTOR vec) const;
+        float distanceSquared(const LEAP_VECTOR first, const LEAP_VECTOR second) const;
+
+        void extractHandFeatures(const LEAP_HAND* hand, HandFeatures& features) const;
+
+        // Device events are only forwarded by the polling thread, opening the device and asking
+        // it about itself happens on the device thread so frames don't wait behind it
+        enum class DeviceEventType {
+            Found,
+            Lost,
+            ConnectionLost
+        };
+        struct DeviceEvent {
+            DeviceEventType type;
+            LEAP_DEVICE_REF device;
+        };
+        void forwardDeviceEvent(const DeviceEventType type, const LEAP_DEVICE_REF& device);
+        void startDeviceThread();
+        void stopDeviceThread();
+        void runDeviceThread();
+        void handleDeviceFound(const LEAP_DEVICE_REF& device);
+        void handleDeviceLost(const LEAP_DEVICE_REF& device);
+        void closeSubscribedDevice();
+        // receivedUs is when the frame came out of LeapPollConnection, on latency_clock_us()
+        void handleTrackingMessage(const LEAP_TRACKING_EVENT *tracking_event, const int64_t receivedUs);
+        // The two halves of handleTrackingMessage. Sampling accounts for the frames LeapC sends,
+        // but only dispatches the ones it interpolates.
+        void accountTrackingFrame(const LEAP_TRACKING_EVENT *tracking_event, const int64_t receivedUs);
+        void dispatchTrackingFrame(const LEAP_TRACKING_EVENT *tracking_event, const int64_t receivedUs);
+        // Interpolates the hands as they are now into sampleBuffer_ and dispatches them
+        void sampleTrackingFrame();
+        // Whether this hand may be followed, going by the handedness setting
+        bool handednessAllows(const LEAP_HAND& hand) const;
+        // Bounds, position and gestures for a hand that is being followed. One of these is picked
+        // by selectHandHandler whenever the settings change, so frames don't test them.
+        template <bool LimitToBounds, bool FilterPosition>
+        void handleHand(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand);
+        void selectHandHandler();
+        // Extracts the hand's features and tests every gesture that has a callback for its side
+        void gestureChecks(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand);
+
+        typedef gesture_callback_t side_callbacks_t[HandSideCount];
+
+        struct GestureDetector {
+            std::string name;
+            gesture_test_t test;
+            uint32_t flags;
+            side_callbacks_t startCallback;
+            side_callbacks_t continueCallback;
+            side_callbacks_t stopCallback;
+        };
 
-        void handleDeviceMessage(const LEAP_DEVICE_EVENT *device_event);
-        void handleTrackingMessage(const LEAP_TRACKING_EVENT *tracking_event);
+        // One hand being followed. Both sides sit in a fixed array, so a second hand costs no allocation.
+        struct HandState {
+            uint32_t handId = 0;            // 0 when no hand is followed on this side
+            uint64_t gesturesActive = 0;    // Currently being made
+            uint64_t gesturesTested = 0;    // Have a callback for this side, or decide whether others are tested
+            position_callback_t positionCallback;
+            PositionFilter positionFilter;
+        };
+
+        void registerBuiltInGestures();
+        // A built-in is...() test as a gesture_test_t, bound at compile time
+        template <bool (UltraleapPoller::*Test)(const HandFeatures&) const>
+        static bool builtInGestureTest(void* poller, const LEAP_HAND&, const HandFeatures& features)
+        {
+            return (static_cast<const UltraleapPoller*>(poller)->*Test)(features);
+        }
+        bool setGestureCallback(const int gesture, side_callbacks_t GestureDetector::*slot, const int side, gesture_callback_t callback);
+        void updateTestedGestures();
+        void testGestures(HandState& state, const UltraleapHandSide side, uint64_t gestures, const int64_t timestamp, const LEAP_HAND* hand, const HandFeatures& features);
 
     private:
-        bool pollerRunning_ = false;
+        std::atomic<bool> pollerRunning_{false};
         float indexPinchThreshold_ = 0.f;
         const float pinchThreshold_ =  0.85f;
         const float middlePinchThreshold_ =  35.f;
@@ -94,15 +398,116 @@ class UltraleapPoller
         const float pinkyPinchThreshold_  =  35.f;
         const float fistThreshold_ =  0.5f;
         const float rotationThreshold_ = 20.f;
+        const float vThreshold_ = 0.6f;
+        const float almostRotationThreshold_ = rotationThreshold_ + 20.f;
+
+        // The distance thresholds above squared, to compare with HandFeatures
+        float indexPinchThresholdSq_ = 0.f;
+        const float middlePinchThresholdSq_ = middlePinchThreshold_ * middlePinchThreshold_;
+        const float ringPinchThresholdSq_   = ringPinchThreshold_ * ringPinchThreshold_;
+        const float pinkyPinchThresholdSq_  = pinkyPinchThreshold_ * pinkyPinchThreshold_;
+        const float rotationThresholdSq_ = rotationThreshold_ * rotationThreshold_;
+        const float almostRotationThresholdSq_ = almostRotationThreshold_ * almostRotationThreshold_;
         std::string handedness_ = BOTH_HANDED;
+        bool bimanual_ = false;
+
+        FrameRecorder recorder_;
+
+        // Indexed by gesture id. The masks have one bit per id.
+        std::vector<GestureDetector> gestures_;
+        uint64_t gesturesSuppressedByFist_ = 0;
 
-        position_callback_t positionCallback_;
+        // Indexed by UltraleapHandSide. Outside bimanual mode only one of them follows a hand at a time.
+        std::array<HandState, HandSideCount> hands_;
+        bool positionFilterActive_ = false;
 
-        eLeapTrackingMode trackingMode_;
-        bool trackingModeDirty_ = false;
+        UltraleapBounds bounds_ = {};
+        // bounds_ as a box in LeapC's millimetres
+        struct BoundsMm {
+            float minX, maxX;
+            float minY, maxY;
+            float minZ, maxZ;
+        } boundsMm_ = {};
 
-        LEAP_CONNECTION lc_;
+        typedef void (UltraleapPoller::*hand_handler_t)(const UltraleapHandSide, const int64_t, const LEAP_HAND*);
+        hand_handler_t handHandler_ = &UltraleapPoller::handleHand<false, false>;
+        frame_callback_t frameStartCallback_;
+        frame_callback_t frameEndCallback_;
+
+        eLeapTrackingMode trackingMode_ = eLeapTrackingMode_Desktop;
+        // Also set by the device thread once it has subscribed
+        std::atomic<bool> trackingModeDirty_{false};
+        // Set by the connection event, a mode can't be set before then
+        bool connected_ = false;
+        std::atomic<int64_t> connectedUs_{0};
+        std::atomic<int64_t> firstFrameUs_{0};
+
+        LEAP_CONNECTION lc_ = nullptr;
         std::thread pollingThread_;
-        
-        uint32_t activeHandID = 0;
+
+        // Set when polling a single device
+        std::string deviceSerial_;
+        // Opened and closed by the device thread once it's running
+        std::atomic<LEAP_DEVICE> device_{nullptr};
+        uint32_t deviceId_ = 0;
+
+        SpscQueue<DeviceEvent, DEVICE_EVENT_QUEUE_CAPACITY> deviceEvents_;
+        std::thread deviceThread_;
+        std::atomic<bool> deviceThreadRunning_{false};
+        std::atomic<bool> deviceThreadSleeping_{false};
+        std::mutex deviceSleepMutex_;
+        std::condition_variable deviceSleepCondition_;
+        // Keyed by device id. Written by the device thread, read by anyone.
+        mutable std::mutex devicesMutex_;
+        std::unordered_map<uint32_t, UltraleapDeviceInfo> devices_;
+
+        UltraleapPollStrategy pollStrategy_ = UltraleapPollStrategy::Hybrid;
+        uint32_t pollTimeoutMs_ = 100;
+        uint32_t pollSpinUs_ = 200;
+        float sampleRateHz_ = 0.f;
+        // Where sampled frames are interpolated to, sized when the poller starts and only grown
+        // if LeapC ever needs more. uint64_t keeps the event aligned.
+        std::vector<uint64_t> sampleBuffer_;
+
+        // Written by the polling thread, read by anyone asking for stats
+        struct PollCounters {
+            std::atomic<uint64_t> polls{0};
+            std::atomic<uint64_t> messages{0};
+            std::atomic<uint64_t> timeouts{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<uint64_t> wakeSamples{0};
+            std::atomic<int64_t>  wakeLatencySumUs{0};
+            std::atomic<int64_t>  maxWakeLatencyUs{0};
+            std::atomic<uint64_t> samples{0};
+            std::atomic<uint64_t> sampleFailures{0};
+            std::atomic<double>   cpuSeconds{0.0};
+            std::atomic<double>   wallSeconds{0.0};
+        } pollCounters_;
+        std::chrono::steady_clock::time_point pollStartTime_;
+
+        // Written by whichever thread handles frames, read by anyone asking for stats
+        struct FrameCounters {
+            std::atomic<uint64_t> processed{0};
+            std::atomic<uint64_t> dropped{0};
+            std::atomic<uint64_t> untracked{0};
+            std::atomic<uint64_t> late{0};
+            std::atomic<uint64_t> outOfOrder{0};
+            std::atomic<float>    deviceFramerate{0.f};
+            std::atomic<double>   effectiveFramerate{0.0};
+        } frameCounters_;
+        // Only touched by the thread handling frames
+        bool haveLastFrame_ = false;
+        int64_t lastTrackingFrameId_ = 0;
+        int64_t lastDeviceFrameId_ = 0;
+        int64_t framerateWindowStartUs_ = 0;
+        uint64_t framerateWindowFrames_ = 0;
+
+        std::atomic<int64_t> deviceClockOffsetUs_{0}; // LeapGetNow() - latency_clock_us()
+        std::atomic<bool> deviceClockSynced_{false};
+
+        // Per stage, for every tracking frame
+        LatencyHistogram pollLatency_;      // Frame timestamp to LeapPollConnection returning it
+        LatencyHistogram gestureLatency_;   // Poll return to the gesture checks (and their callbacks) being done
+        LatencyHistogram callbackLatency_;  // Gesture checks done to the frame end callback returning
+        double pollThreadCpuStart_ = 0.0;
 };
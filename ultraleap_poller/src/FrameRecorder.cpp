@@ -0,0 +1,171 @@
+#include "FrameRecorder.h"
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(FrameRecordingHeader) % alignof(FrameRecord) == 0, "Records must stay aligned after the header");
+
+FrameRecorder::FrameRecorder()
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+}
+
+bool FrameRecorder::Open(const std::string& path, uint64_t capacity)
+{
+	Close();
+
+	if (capacity == 0)
+	{
+		printf("Recording capacity must be at least one frame.\n");
+		return false;
+	}
+
+	size_t size = sizeof(FrameRecordingHeader) + capacity * sizeof(FrameRecord);
+	void* mapped = nullptr;
+
+#ifdef WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+	                          CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Could not create recording %s.\n", path.c_str());
+		return false;
+	}
+
+	ULARGE_INTEGER fileSize;
+	fileSize.QuadPart = size;
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, fileSize.HighPart, fileSize.LowPart, nullptr);
+	if (mapping != nullptr)
+	{
+		mapped = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+	}
+
+	if (mapped == nullptr)
+	{
+		printf("Could not map recording %s.\n", path.c_str());
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+#else
+	int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		printf("Could not create recording %s.\n", path.c_str());
+		return false;
+	}
+
+	// Reserve the blocks up front so filling the ring can't fail for lack of disk space
+	if (posix_fallocate(fd, 0, static_cast<off_t>(size)) != 0 &&
+	    ftruncate(fd, static_cast<off_t>(size)) != 0)
+	{
+		printf("Could not size recording %s.\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	// MAP_POPULATE faults every page in now rather than on the polling thread later
+	mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		printf("Could not map recording %s.\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	fd_ = fd;
+#endif
+
+	mappedSize_ = size;
+	header_ = new (mapped) FrameRecordingHeader();
+	header_->magic = FRAME_RECORDING_MAGIC;
+	header_->version = FRAME_RECORDING_VERSION;
+	header_->recordSize = sizeof(FrameRecord);
+	header_->maxHands = FRAME_RECORDING_MAX_HANDS;
+	header_->capacity = capacity;
+	header_->writeCount.store(0, std::memory_order_release);
+	records_ = reinterpret_cast<FrameRecord*>(static_cast<uint8_t*>(mapped) + sizeof(FrameRecordingHeader));
+
+	printf("Recording up to %llu frames to %s\n", static_cast<unsigned long long>(capacity), path.c_str());
+	return true;
+}
+
+void FrameRecorder::Close()
+{
+	if (header_ == nullptr)
+	{
+		return;
+	}
+
+	printf("Recorded %llu frames\n", static_cast<unsigned long long>(RecordedFrames()));
+
+#ifdef WIN32
+	FlushViewOfFile(header_, mappedSize_);
+	UnmapViewOfFile(header_);
+	CloseHandle(static_cast<HANDLE>(mapping_));
+	CloseHandle(static_cast<HANDLE>(file_));
+	mapping_ = nullptr;
+	file_ = nullptr;
+#else
+	msync(header_, mappedSize_, MS_ASYNC);
+	munmap(header_, mappedSize_);
+	close(fd_);
+	fd_ = -1;
+#endif
+
+	header_ = nullptr;
+	records_ = nullptr;
+	mappedSize_ = 0;
+}
+
+bool FrameRecorder::IsOpen() const
+{
+	return header_ != nullptr;
+}
+
+void FrameRecorder::Record(const LEAP_TRACKING_EVENT* tracking_event)
+{
+	if (header_ == nullptr)
+	{
+		return;
+	}
+
+	// Only this thread writes, so a relaxed read of our own count is enough
+	uint64_t count = header_->writeCount.load(std::memory_order_relaxed);
+	FrameRecord& record = records_[count % header_->capacity];
+
+	uint32_t nHands = tracking_event->nHands < FRAME_RECORDING_MAX_HANDS ? tracking_event->nHands : FRAME_RECORDING_MAX_HANDS;
+	record.timestamp = tracking_event->info.timestamp;
+	record.frameId = tracking_event->info.frame_id;
+	record.trackingFrameId = tracking_event->tracking_frame_id;
+	record.framerate = tracking_event->framerate;
+	record.nHands = nHands;
+	memcpy(record.hands, tracking_event->pHands, nHands * sizeof(LEAP_HAND));
+
+	// Publish the record to anyone reading the file
+	header_->writeCount.store(count + 1, std::memory_order_release);
+}
+
+uint64_t FrameRecorder::RecordedFrames() const
+{
+	return header_ == nullptr ? 0 : header_->writeCount.load(std::memory_order_acquire);
+}
@@ -0,0 +1,157 @@
+#include "FrameReplayer.h"
+
+#include <cstdio>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+FrameReplayer::FrameReplayer()
+{
+}
+
+FrameReplayer::~FrameReplayer()
+{
+	Close();
+}
+
+bool FrameReplayer::Open(const std::string& path)
+{
+	Close();
+
+	const void* mapped = nullptr;
+	size_t size = 0;
+
+#ifdef WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		printf("Could not open recording %s.\n", path.c_str());
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &fileSize))
+	{
+		size = static_cast<size_t>(fileSize.QuadPart);
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (mapping != nullptr)
+	{
+		mapped = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+
+	if (mapped == nullptr)
+	{
+		printf("Could not map recording %s.\n", path.c_str());
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+#else
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		printf("Could not open recording %s.\n", path.c_str());
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FrameRecordingHeader)))
+	{
+		printf("Recording %s is too short.\n", path.c_str());
+		close(fd);
+		return false;
+	}
+	size = static_cast<size_t>(st.st_size);
+
+	mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED)
+	{
+		printf("Could not map recording %s.\n", path.c_str());
+		close(fd);
+		return false;
+	}
+
+	fd_ = fd;
+#endif
+
+	header_ = static_cast<const FrameRecordingHeader*>(mapped);
+	mappedSize_ = size;
+
+	// Records are raw structs, so only recordings from a build with the same layout are usable
+	if (size < sizeof(FrameRecordingHeader) ||
+	    header_->magic != FRAME_RECORDING_MAGIC ||
+	    header_->version != FRAME_RECORDING_VERSION ||
+	    header_->recordSize != sizeof(FrameRecord) ||
+	    header_->maxHands != FRAME_RECORDING_MAX_HANDS ||
+	    header_->capacity == 0 ||
+	    size < sizeof(FrameRecordingHeader) + header_->capacity * sizeof(FrameRecord))
+	{
+		printf("%s is not a recording this build can read.\n", path.c_str());
+		Close();
+		return false;
+	}
+
+	records_ = reinterpret_cast<const FrameRecord*>(static_cast<const uint8_t*>(mapped) + sizeof(FrameRecordingHeader));
+
+	uint64_t written = header_->writeCount.load(std::memory_order_acquire);
+	count_ = written < header_->capacity ? written : header_->capacity;
+	first_ = written < header_->capacity ? 0 : written % header_->capacity;
+
+	return true;
+}
+
+void FrameReplayer::Close()
+{
+	if (header_ == nullptr)
+	{
+		return;
+	}
+
+#ifdef WIN32
+	UnmapViewOfFile(header_);
+	CloseHandle(static_cast<HANDLE>(mapping_));
+	CloseHandle(static_cast<HANDLE>(file_));
+	mapping_ = nullptr;
+	file_ = nullptr;
+#else
+	munmap(const_cast<FrameRecordingHeader*>(header_), mappedSize_);
+	close(fd_);
+	fd_ = -1;
+#endif
+
+	header_ = nullptr;
+	records_ = nullptr;
+	mappedSize_ = 0;
+	first_ = 0;
+	count_ = 0;
+}
+
+bool FrameReplayer::IsOpen() const
+{
+	return header_ != nullptr;
+}
+
+uint64_t FrameReplayer::FrameCount() const
+{
+	return count_;
+}
+
+const FrameRecord& FrameReplayer::Frame(const uint64_t index) const
+{
+	return records_[(first_ + index) % header_->capacity];
+}
@@ -0,0 +1,270 @@
+#include "GestureBatch.h"
+#include "GestureBatchKernels.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GESTURE_BATCH_X86
+#endif
+
+// SSE2 is part of the x86-64 baseline, 32-bit builds only have it if the compiler was told to
+#if defined(GESTURE_BATCH_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GESTURE_BATCH_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(GESTURE_BATCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef FLEDERMAUS_HAVE_AVX2_KERNEL
+// GestureBatchAVX2.cpp
+size_t classify_gesture_batch_avx2(const GestureBatchView& view, const GestureThresholds& thresholds, uint16_t* masks);
+#endif
+
+void GestureFrameBatch::Reserve(const size_t frames)
+{
+	for (std::vector<float>& channel : channels_)
+	{
+		channel.reserve(frames);
+	}
+}
+
+void GestureFrameBatch::Clear()
+{
+	for (std::vector<float>& channel : channels_)
+	{
+		channel.clear();
+	}
+}
+
+void GestureFrameBatch::Add(const LEAP_HAND& hand)
+{
+	const LEAP_DIGIT* tips[5] = {&hand.thumb, &hand.index, &hand.middle, &hand.ring, &hand.pinky};
+	for (int f = 0; f < 5; f++)
+	{
+		channels_[BATCH_THUMB_TIP_X + f * 3].push_back(tips[f]->distal.next_joint.x);
+		channels_[BATCH_THUMB_TIP_Y + f * 3].push_back(tips[f]->distal.next_joint.y);
+		channels_[BATCH_THUMB_TIP_Z + f * 3].push_back(tips[f]->distal.next_joint.z);
+	}
+
+	const LEAP_DIGIT* distals[3] = {&hand.index, &hand.middle, &hand.pinky};
+	for (int f = 0; f < 3; f++)
+	{
+		channels_[BATCH_INDEX_DISTAL_X + f * 3].push_back(distals[f]->distal.prev_joint.x);
+		channels_[BATCH_INDEX_DISTAL_Y + f * 3].push_back(distals[f]->distal.prev_joint.y);
+		channels_[BATCH_INDEX_DISTAL_Z + f * 3].push_back(distals[f]->distal.prev_joint.z);
+	}
+
+	channels_[BATCH_INDEX_KNUCKLE_X].push_back(hand.index.proximal.prev_joint.x);
+	channels_[BATCH_INDEX_KNUCKLE_Z].push_back(hand.index.proximal.prev_joint.z);
+	channels_[BATCH_PINKY_KNUCKLE_X].push_back(hand.pinky.proximal.prev_joint.x);
+	channels_[BATCH_PINKY_KNUCKLE_Z].push_back(hand.pinky.proximal.prev_joint.z);
+	channels_[BATCH_PINCH_STRENGTH].push_back(hand.pinch_strength);
+	channels_[BATCH_GRAB_STRENGTH].push_back(hand.grab_strength);
+}
+
+size_t GestureFrameBatch::Size() const
+{
+	return channels_[0].size();
+}
+
+GestureBatchView GestureFrameBatch::View() const
+{
+	GestureBatchView view;
+	for (int c = 0; c < BATCH_CHANNEL_COUNT; c++)
+	{
+		view.channels[c] = channels_[c].data();
+	}
+	view.size = Size();
+	return view;
+}
+
+// One frame at a time, for the frames left over after the vector kernels
+static void classify_gesture_scalar(const GestureBatchView& view, const GestureThresholds& t, uint16_t* masks, size_t begin)
+{
+	const float* const* c = view.channels;
+	for (size_t i = begin; i < view.size; i++)
+	{
+		float tipSq[4];
+		for (int f = 0; f < 4; f++)
+		{
+			float dx = c[BATCH_THUMB_TIP_X][i] - c[BATCH_INDEX_TIP_X + f * 3][i];
+			float dy = c[BATCH_THUMB_TIP_Y][i] - c[BATCH_INDEX_TIP_Y + f * 3][i];
+			float dz = c[BATCH_THUMB_TIP_Z][i] - c[BATCH_INDEX_TIP_Z + f * 3][i];
+			tipSq[f] = dx * dx + dy * dy + dz * dz;
+		}
+
+		float indexX = c[BATCH_INDEX_TIP_X][i] - c[BATCH_INDEX_DISTAL_X][i];
+		float indexY = c[BATCH_INDEX_TIP_Y][i] - c[BATCH_INDEX_DISTAL_Y][i];
+		float indexZ = c[BATCH_INDEX_TIP_Z][i] - c[BATCH_INDEX_DISTAL_Z][i];
+		float middleX = c[BATCH_MIDDLE_TIP_X][i] - c[BATCH_MIDDLE_DISTAL_X][i];
+		float middleY = c[BATCH_MIDDLE_TIP_Y][i] - c[BATCH_MIDDLE_DISTAL_Y][i];
+		float middleZ = c[BATCH_MIDDLE_TIP_Z][i] - c[BATCH_MIDDLE_DISTAL_Z][i];
+		float pinkyX = c[BATCH_PINKY_TIP_X][i] - c[BATCH_PINKY_DISTAL_X][i];
+		float pinkyY = c[BATCH_PINKY_TIP_Y][i] - c[BATCH_PINKY_DISTAL_Y][i];
+		float pinkyZ = c[BATCH_PINKY_TIP_Z][i] - c[BATCH_PINKY_DISTAL_Z][i];
+
+		float indexMiddleCos = (indexX * middleX + indexY * middleY + indexZ * middleZ) /
+		                       std::sqrt((indexX * indexX + indexY * indexY + indexZ * indexZ) *
+		                                 (middleX * middleX + middleY * middleY + middleZ * middleZ));
+		float indexPinky = indexX * pinkyX + indexY * pinkyY + indexZ * pinkyZ;
+
+		float spreadX = c[BATCH_INDEX_KNUCKLE_X][i] - c[BATCH_PINKY_KNUCKLE_X][i];
+		float spreadZ = c[BATCH_INDEX_KNUCKLE_Z][i] - c[BATCH_PINKY_KNUCKLE_Z][i];
+		float spreadSq = spreadX * spreadX + spreadZ * spreadZ;
+
+		float pinch = c[BATCH_PINCH_STRENGTH][i];
+		float grab = c[BATCH_GRAB_STRENGTH][i];
+
+		uint16_t m = 0;
+		if (pinch < t.pinch && pinch > t.almostPinchLower) m |= GESTURE_BIT_ALMOST_PINCH;
+		if (pinch > t.pinch) m |= GESTURE_BIT_PINCH;
+		if (tipSq[0] < t.indexPinchSq && tipSq[1] > t.indexPinchSq && tipSq[2] > t.indexPinchSq && tipSq[3] > t.indexPinchSq) m |= GESTURE_BIT_INDEX_PINCH;
+		if (tipSq[0] > t.middlePinchSq && tipSq[1] < t.middlePinchSq && tipSq[2] > t.middlePinchSq && tipSq[3] > t.middlePinchSq) m |= GESTURE_BIT_MIDDLE_PINCH;
+		if (tipSq[0] > t.ringPinchSq && tipSq[1] > t.ringPinchSq && tipSq[2] < t.ringPinchSq && tipSq[3] > t.ringPinchSq) m |= GESTURE_BIT_RING_PINCH;
+		if (tipSq[0] > t.pinkyPinchSq && tipSq[1] > t.pinkyPinchSq && tipSq[2] > t.pinkyPinchSq && tipSq[3] < t.pinkyPinchSq) m |= GESTURE_BIT_PINKY_PINCH;
+		if (grab > t.fist) m |= GESTURE_BIT_FIST;
+		if (indexMiddleCos > t.vCos && indexPinky < 0) m |= GESTURE_BIT_V;
+		if (spreadSq > t.rotationSq && spreadSq < t.almostRotationSq) m |= GESTURE_BIT_ALMOST_ROTATE;
+		if (spreadSq < t.rotationSq) m |= GESTURE_BIT_ROTATE;
+		masks[i] = m;
+	}
+}
+
+#ifdef GESTURE_BATCH_SSE
+struct SSELanes
+{
+	static const size_t WIDTH = 4;
+	typedef __m128 F;
+	typedef __m128i I;
+
+	static F load(const float* p) { return _mm_loadu_ps(p); }
+	static F set1(float v) { return _mm_set1_ps(v); }
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm_div_ps(a, b); }
+	static F sqrt(F a) { return _mm_sqrt_ps(a); }
+	static F lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+	static F gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+	static F both(F a, F b) { return _mm_and_ps(a, b); }
+	static I bits(F cond, unsigned bit) { return _mm_and_si128(_mm_castps_si128(cond), _mm_set1_epi32(static_cast<int>(bit))); }
+	static I either(I a, I b) { return _mm_or_si128(a, b); }
+	static void store(uint16_t* out, I m) { _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(m, m)); }
+};
+#endif
+
+static bool cpu_has_avx2()
+{
+#if !defined(FLEDERMAUS_HAVE_AVX2_KERNEL)
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+	{
+		return false;
+	}
+
+	// The OS must also save the AVX registers on a context switch
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool GestureBatchKernelSupported(const GestureBatchKernel kernel)
+{
+	switch (kernel)
+	{
+	case GestureBatchKernel::Auto:
+	case GestureBatchKernel::Scalar:
+		return true;
+	case GestureBatchKernel::SSE:
+#ifdef GESTURE_BATCH_SSE
+		return true;
+#else
+		return false;
+#endif
+	case GestureBatchKernel::AVX2:
+	{
+		static const bool avx2 = cpu_has_avx2();
+		return avx2;
+	}
+	default:
+		return false;
+	}
+}
+
+GestureBatchKernel BestGestureBatchKernel()
+{
+	if (GestureBatchKernelSupported(GestureBatchKernel::AVX2))
+	{
+		return GestureBatchKernel::AVX2;
+	}
+	else if (GestureBatchKernelSupported(GestureBatchKernel::SSE))
+	{
+		return GestureBatchKernel::SSE;
+	}
+	return GestureBatchKernel::Scalar;
+}
+
+const char* GestureBatchKernelName(const GestureBatchKernel kernel)
+{
+	switch (kernel)
+	{
+	case GestureBatchKernel::Auto:
+		return "auto";
+	case GestureBatchKernel::Scalar:
+		return "scalar";
+	case GestureBatchKernel::SSE:
+		return "sse";
+	case GestureBatchKernel::AVX2:
+		return "avx2";
+	default:
+		return "unknown";
+	}
+}
+
+void ClassifyGestureBatch(const GestureFrameBatch& batch, const GestureThresholds& thresholds, uint16_t* masks,
+                          const GestureBatchKernel kernel)
+{
+	GestureBatchKernel chosen = kernel == GestureBatchKernel::Auto ? BestGestureBatchKernel() : kernel;
+	if (!GestureBatchKernelSupported(chosen))
+	{
+		chosen = GestureBatchKernel::Scalar;
+	}
+
+	const GestureBatchView view = batch.View();
+	size_t done = 0;
+
+	switch (chosen)
+	{
+#ifdef FLEDERMAUS_HAVE_AVX2_KERNEL
+	case GestureBatchKernel::AVX2:
+		done = classify_gesture_batch_avx2(view, thresholds, masks);
+		break;
+#endif
+#ifdef GESTURE_BATCH_SSE
+	case GestureBatchKernel::SSE:
+		done = classify_gesture_lanes<SSELanes>(view, thresholds, masks);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	classify_gesture_scalar(view, thresholds, masks, done);
+}
@@ -0,0 +1,43 @@
+// Built with AVX2 enabled (see CMakeLists.txt) and only ever called after the CPU has been
+// checked for it, so keep anything else out of this file.
+
+#include "GestureBatchKernels.h"
+
+#include <immintrin.h>
+
+namespace
+{
+
+struct AVX2Lanes
+{
+	static const size_t WIDTH = 8;
+	typedef __m256 F;
+	typedef __m256i I;
+
+	static F load(const float* p) { return _mm256_loadu_ps(p); }
+	static F set1(float v) { return _mm256_set1_ps(v); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F div(F a, F b) { return _mm256_div_ps(a, b); }
+	static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	// Ordered comparisons, so NaN fails them as it does in the scalar tests
+	static F lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static F gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static F both(F a, F b) { return _mm256_and_ps(a, b); }
+	static I bits(F cond, unsigned bit) { return _mm256_and_si256(_mm256_castps_si256(cond), _mm256_set1_epi32(static_cast<int>(bit))); }
+	static I either(I a, I b) { return _mm256_or_si256(a, b); }
+	static void store(uint16_t* out, I m)
+	{
+		// Packing works within each 128-bit half, so gather the two halves' results back together
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(m, m), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+	}
+};
+
+}
+
+size_t classify_gesture_batch_avx2(const GestureBatchView& view, const GestureThresholds& thresholds, uint16_t* masks)
+{
+	return classify_gesture_lanes<AVX2Lanes>(view, thresholds, masks);
+}
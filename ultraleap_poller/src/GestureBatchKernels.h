@@ -0,0 +1,104 @@
+#pragma once
+
+#include "GestureBatch.h"
+
+// The gesture tests written once for any SIMD width. `Lanes` wraps one instruction set:
+//   F, I          float and 32-bit integer vectors of WIDTH lanes
+//   load, set1    unaligned load and broadcast
+//   add, sub, mul, div, sqrt, lt, gt, both (and)
+//   bits(cond, bit)   `bit` in lanes where cond holds, 0 elsewhere
+//   either(a, b)      or of two such masks
+//   store(out, masks) narrows the masks to WIDTH uint16_t
+//
+// Every operation is done in the same order as UltraleapPoller::extractHandFeatures, with no
+// fused multiply-adds, so the results match the scalar tests bit for bit.
+//
+// Only raw pointers cross into here: this is compiled with different instruction sets in
+// different translation units, and must not instantiate any inline library code that the
+// linker could then share with code built for the baseline.
+//
+// Returns the number of frames classified, a multiple of WIDTH. The caller does the rest.
+template <typename Lanes>
+size_t classify_gesture_lanes(const GestureBatchView& view, const GestureThresholds& t, uint16_t* masks)
+{
+	typedef typename Lanes::F F;
+	typedef typename Lanes::I I;
+
+	const float* const* c = view.channels;
+	const size_t blocks = view.size - view.size % Lanes::WIDTH;
+
+	const F almostPinchLower = Lanes::set1(t.almostPinchLower);
+	const F pinch = Lanes::set1(t.pinch);
+	const F indexPinchSq = Lanes::set1(t.indexPinchSq);
+	const F middlePinchSq = Lanes::set1(t.middlePinchSq);
+	const F ringPinchSq = Lanes::set1(t.ringPinchSq);
+	const F pinkyPinchSq = Lanes::set1(t.pinkyPinchSq);
+	const F fist = Lanes::set1(t.fist);
+	const F vCos = Lanes::set1(t.vCos);
+	const F rotationSq = Lanes::set1(t.rotationSq);
+	const F almostRotationSq = Lanes::set1(t.almostRotationSq);
+	const F zero = Lanes::set1(0.f);
+
+	for (size_t i = 0; i < blocks; i += Lanes::WIDTH)
+	{
+		const F thumbX = Lanes::load(c[BATCH_THUMB_TIP_X] + i);
+		const F thumbY = Lanes::load(c[BATCH_THUMB_TIP_Y] + i);
+		const F thumbZ = Lanes::load(c[BATCH_THUMB_TIP_Z] + i);
+
+		F tipSq[4];
+		for (int f = 0; f < 4; f++)
+		{
+			const GestureBatchChannel tip = static_cast<GestureBatchChannel>(BATCH_INDEX_TIP_X + f * 3);
+			F dx = Lanes::sub(thumbX, Lanes::load(c[tip] + i));
+			F dy = Lanes::sub(thumbY, Lanes::load(c[tip + 1] + i));
+			F dz = Lanes::sub(thumbZ, Lanes::load(c[tip + 2] + i));
+			tipSq[f] = Lanes::add(Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)), Lanes::mul(dz, dz));
+		}
+
+		const F indexX = Lanes::sub(Lanes::load(c[BATCH_INDEX_TIP_X] + i), Lanes::load(c[BATCH_INDEX_DISTAL_X] + i));
+		const F indexY = Lanes::sub(Lanes::load(c[BATCH_INDEX_TIP_Y] + i), Lanes::load(c[BATCH_INDEX_DISTAL_Y] + i));
+		const F indexZ = Lanes::sub(Lanes::load(c[BATCH_INDEX_TIP_Z] + i), Lanes::load(c[BATCH_INDEX_DISTAL_Z] + i));
+		const F middleX = Lanes::sub(Lanes::load(c[BATCH_MIDDLE_TIP_X] + i), Lanes::load(c[BATCH_MIDDLE_DISTAL_X] + i));
+		const F middleY = Lanes::sub(Lanes::load(c[BATCH_MIDDLE_TIP_Y] + i), Lanes::load(c[BATCH_MIDDLE_DISTAL_Y] + i));
+		const F middleZ = Lanes::sub(Lanes::load(c[BATCH_MIDDLE_TIP_Z] + i), Lanes::load(c[BATCH_MIDDLE_DISTAL_Z] + i));
+		const F pinkyX = Lanes::sub(Lanes::load(c[BATCH_PINKY_TIP_X] + i), Lanes::load(c[BATCH_PINKY_DISTAL_X] + i));
+		const F pinkyY = Lanes::sub(Lanes::load(c[BATCH_PINKY_TIP_Y] + i), Lanes::load(c[BATCH_PINKY_DISTAL_Y] + i));
+		const F pinkyZ = Lanes::sub(Lanes::load(c[BATCH_PINKY_TIP_Z] + i), Lanes::load(c[BATCH_PINKY_DISTAL_Z] + i));
+
+		const F indexMiddle = Lanes::add(Lanes::add(Lanes::mul(indexX, middleX), Lanes::mul(indexY, middleY)), Lanes::mul(indexZ, middleZ));
+		const F indexIndex = Lanes::add(Lanes::add(Lanes::mul(indexX, indexX), Lanes::mul(indexY, indexY)), Lanes::mul(indexZ, indexZ));
+		const F middleMiddle = Lanes::add(Lanes::add(Lanes::mul(middleX, middleX), Lanes::mul(middleY, middleY)), Lanes::mul(middleZ, middleZ));
+		const F indexPinky = Lanes::add(Lanes::add(Lanes::mul(indexX, pinkyX), Lanes::mul(indexY, pinkyY)), Lanes::mul(indexZ, pinkyZ));
+		const F indexMiddleCos = Lanes::div(indexMiddle, Lanes::sqrt(Lanes::mul(indexIndex, middleMiddle)));
+
+		const F spreadX = Lanes::sub(Lanes::load(c[BATCH_INDEX_KNUCKLE_X] + i), Lanes::load(c[BATCH_PINKY_KNUCKLE_X] + i));
+		const F spreadZ = Lanes::sub(Lanes::load(c[BATCH_INDEX_KNUCKLE_Z] + i), Lanes::load(c[BATCH_PINKY_KNUCKLE_Z] + i));
+		const F spreadSq = Lanes::add(Lanes::mul(spreadX, spreadX), Lanes::mul(spreadZ, spreadZ));
+
+		const F pinchStrength = Lanes::load(c[BATCH_PINCH_STRENGTH] + i);
+		const F grabStrength = Lanes::load(c[BATCH_GRAB_STRENGTH] + i);
+
+		I m = Lanes::bits(Lanes::both(Lanes::lt(pinchStrength, pinch), Lanes::gt(pinchStrength, almostPinchLower)), GESTURE_BIT_ALMOST_PINCH);
+		m = Lanes::either(m, Lanes::bits(Lanes::gt(pinchStrength, pinch), GESTURE_BIT_PINCH));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::both(Lanes::lt(tipSq[0], indexPinchSq), Lanes::gt(tipSq[1], indexPinchSq)),
+		                                             Lanes::both(Lanes::gt(tipSq[2], indexPinchSq), Lanes::gt(tipSq[3], indexPinchSq))),
+		                                 GESTURE_BIT_INDEX_PINCH));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::both(Lanes::gt(tipSq[0], middlePinchSq), Lanes::lt(tipSq[1], middlePinchSq)),
+		                                             Lanes::both(Lanes::gt(tipSq[2], middlePinchSq), Lanes::gt(tipSq[3], middlePinchSq))),
+		                                 GESTURE_BIT_MIDDLE_PINCH));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::both(Lanes::gt(tipSq[0], ringPinchSq), Lanes::gt(tipSq[1], ringPinchSq)),
+		                                             Lanes::both(Lanes::lt(tipSq[2], ringPinchSq), Lanes::gt(tipSq[3], ringPinchSq))),
+		                                 GESTURE_BIT_RING_PINCH));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::both(Lanes::gt(tipSq[0], pinkyPinchSq), Lanes::gt(tipSq[1], pinkyPinchSq)),
+		                                             Lanes::both(Lanes::gt(tipSq[2], pinkyPinchSq), Lanes::lt(tipSq[3], pinkyPinchSq))),
+		                                 GESTURE_BIT_PINKY_PINCH));
+		m = Lanes::either(m, Lanes::bits(Lanes::gt(grabStrength, fist), GESTURE_BIT_FIST));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::gt(indexMiddleCos, vCos), Lanes::lt(indexPinky, zero)), GESTURE_BIT_V));
+		m = Lanes::either(m, Lanes::bits(Lanes::both(Lanes::gt(spreadSq, rotationSq), Lanes::lt(spreadSq, almostRotationSq)), GESTURE_BIT_ALMOST_ROTATE));
+		m = Lanes::either(m, Lanes::bits(Lanes::lt(spreadSq, rotationSq), GESTURE_BIT_ROTATE));
+
+		Lanes::store(masks + i, m);
+	}
+
+	return blocks;
+}
@@ -0,0 +1,121 @@
+#include "PositionFilter.h"
+
+#include <cmath>
+
+// A gap this long between frames means the hand was lost, so start over
+#define POSITION_FILTER_MAX_GAP_US 100000
+#define PI_F 3.14159265f
+
+// Time constant of an exponential smoother with this cutoff
+static float smoothing_tau(const float cutoffHz)
+{
+	return 1.f / (2.f * PI_F * cutoffHz);
+}
+
+// Weight of a new sample in an exponential smoother with this cutoff, at this sample interval
+static float smoothing_alpha(const float cutoffHz, const float dt)
+{
+	return 1.f / (1.f + smoothing_tau(cutoffHz) / dt);
+}
+
+PositionFilter::PositionFilter()
+{
+	settings_.minCutoffHz = 1.f;
+	settings_.beta = 0.02f;
+	settings_.derivativeCutoffHz = 1.f;
+	settings_.leadMs = 0.f;
+	Reset();
+}
+
+void PositionFilter::SetSettings(const PositionFilterSettings& settings)
+{
+	settings_ = settings;
+	SetLeadTime(settings.leadMs);
+	Reset();
+}
+
+void PositionFilter::SetLeadTime(const float leadMs)
+{
+	leadSeconds_.store(leadMs > 0.f ? leadMs * 0.001f : 0.f, std::memory_order_relaxed);
+}
+
+float PositionFilter::GetLeadTime() const
+{
+	return leadSeconds_.load(std::memory_order_relaxed) * 1000.f;
+}
+
+void PositionFilter::Reset()
+{
+	primed_ = false;
+	lastTimestampUs_ = 0;
+	for (Axis& axis : axes_)
+	{
+		axis.raw = 0.f;
+		axis.position = 0.f;
+		axis.velocity = 0.f;
+		axis.acceleration = 0.f;
+		axis.lag = 0.f;
+	}
+}
+
+LEAP_VECTOR PositionFilter::Filter(const LEAP_VECTOR& position, const int64_t timestampUs)
+{
+	const int64_t gapUs = timestampUs - lastTimestampUs_;
+	if (!primed_ || gapUs <= 0 || gapUs > POSITION_FILTER_MAX_GAP_US)
+	{
+		// Nothing to go on yet, or nothing sensible
+		for (int i = 0; i < 3; i++)
+		{
+			axes_[i].raw = position.v[i];
+			axes_[i].position = position.v[i];
+			axes_[i].velocity = 0.f;
+			axes_[i].acceleration = 0.f;
+			axes_[i].lag = 0.f;
+		}
+		primed_ = true;
+		lastTimestampUs_ = timestampUs;
+		return position;
+	}
+	lastTimestampUs_ = timestampUs;
+
+	const float dt = static_cast<float>(gapUs) * 1e-6f;
+	const float lead = leadSeconds_.load(std::memory_order_relaxed);
+
+	LEAP_VECTOR result;
+	for (int i = 0; i < 3; i++)
+	{
+		filterAxis(axes_[i], position.v[i], dt);
+		result.v[i] = predictAxis(axes_[i], lead);
+	}
+	return result;
+}
+
+float PositionFilter::filterAxis(Axis& axis, const float value, const float dt) const
+{
+	// Velocity and acceleration from consecutive frames, smoothed at a fixed cutoff
+	const float derivativeAlpha = smoothing_alpha(settings_.derivativeCutoffHz, dt);
+	const float rawVelocity = (value - axis.raw) / dt;
+	axis.raw = value;
+	const float velocity = axis.velocity + derivativeAlpha * (rawVelocity - axis.velocity);
+	const float rawAcceleration = (velocity - axis.velocity) / dt;
+	axis.acceleration += derivativeAlpha * (rawAcceleration - axis.acceleration);
+	axis.velocity = velocity;
+
+	// The faster the hand moves, the less it is smoothed, so fast moves don't lag
+	const float cutoff = settings_.minCutoffHz + settings_.beta * std::fabs(velocity);
+	axis.position += smoothing_alpha(cutoff, dt) * (value - axis.position);
+	axis.lag = smoothing_tau(cutoff);
+	return axis.position;
+}
+
+float PositionFilter::predictAxis(const Axis& axis, const float lead) const
+{
+	if (lead <= 0.f)
+	{
+		return axis.position;
+	}
+
+	// Make up for the smoothing's own lag as well as the pipeline's
+	const float ahead = lead + axis.lag;
+	return axis.position + axis.velocity * ahead + 0.5f * axis.acceleration * ahead * ahead;
+}
@@ -1,8 +1,33 @@
 #include "UltraleapPoller.h"
+#include "FrameReplayer.h"
 
 #include <cmath>
+#include <cstdint>
 #include <string>
 
+#ifdef WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Repeated poll errors (e.g. no service running) back off up to this long
+#define POLL_BACKOFF_MIN_MS 1
+#define POLL_BACKOFF_MAX_MS 1000
+// How often the polling thread samples its own CPU time, and lines the device clock back up
+#define POLL_CPU_SAMPLE_INTERVAL_MS 1000
+// Reads of the two clocks to take when lining them up, the tightest pair is kept
+#define CLOCK_SYNC_SAMPLES 5
+// ListDeviceSerials stops waiting once no new device has turned up for this long
+#define DEVICE_LIST_QUIET_MS 250
+// Room for a serial number before asking LeapC how long it really is
+#define DEVICE_SERIAL_LENGTH_GUESS 64
+// How long the device thread sleeps before checking whether it should stop
+#define DEVICE_THREAD_SLEEP_MS 100
+// Hands the sample buffer has room for before it has to grow
+#define SAMPLE_BUFFER_HANDS 2
+
 char* errno_to_string(eLeapRS rs)
 {
 	switch (rs)
@@ -50,296 +75,1506 @@ char* errno_to_string(eLeapRS rs)
 	case eLeapRS_Unsupported:
 		return "eLeapRS_Unsupported";
 	default:
-		return "Unrecognised error code";
+		return "Unrecognised error code";
+	}
+}
+
+static const char* poll_strategy_to_string(UltraleapPollStrategy strategy)
+{
+	switch (strategy)
+	{
+	case UltraleapPollStrategy::Busy:
+		return POLL_STRATEGY_BUSY;
+	case UltraleapPollStrategy::Blocking:
+		return POLL_STRATEGY_BLOCKING;
+	case UltraleapPollStrategy::Hybrid:
+		return POLL_STRATEGY_HYBRID;
+	default:
+		return "unknown";
+	}
+}
+
+static_assert(BuiltInGestureCount <= MAX_GESTURES, "Gesture masks are 64 bits");
+static_assert(GESTURE_BIT_FIST == 1u << GestureFist && GESTURE_BIT_ROTATE == 1u << GestureRotate,
+              "Batch classifier bits and gesture ids must agree");
+
+static int lowest_set_bit(const uint64_t bits)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<unsigned long>(bits)))
+	{
+		return static_cast<int>(index);
+	}
+	_BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+	return static_cast<int>(index) + 32;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+// CPU time used so far by the calling thread
+static double thread_cpu_seconds()
+{
+#ifdef WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+	{
+		return 0.0;
+	}
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	// 100ns ticks
+	return static_cast<double>(k.QuadPart + u.QuadPart) * 1e-7;
+#else
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+	{
+		return 0.0;
+	}
+	return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+// Reads what LeapC knows about the device, other than its id. Returns "false" if LeapC won't say.
+static bool read_device_info(LEAP_DEVICE dev, UltraleapDeviceInfo& info)
+{
+	// We have to provide a buffer for the serial string. Today's serials fit in this, and if a
+	// longer one turns up LeapC says how long it is.
+	std::vector<char> serial(DEVICE_SERIAL_LENGTH_GUESS);
+	LEAP_DEVICE_INFO deviceProperties = {};
+	deviceProperties.size = sizeof(deviceProperties);
+	deviceProperties.serial_length = static_cast<uint32_t>(serial.size());
+	deviceProperties.serial = serial.data();
+	eLeapRS res = LeapGetDeviceInfo(dev, &deviceProperties);
+	if (res == eLeapRS_InsufficientBuffer)
+	{
+		// try again with correct buffer size
+		serial.resize(deviceProperties.serial_length);
+		deviceProperties.serial = serial.data();
+		res = LeapGetDeviceInfo(dev, &deviceProperties);
+	}
+	if (res != eLeapRS_Success)
+	{
+		printf("Failed to get device info %s.\n", errno_to_string(res));
+		return false;
+	}
+
+	info.serial = deviceProperties.serial;
+	info.pid = deviceProperties.pid;
+	info.baseline = deviceProperties.baseline;
+	info.hFov = deviceProperties.h_fov;
+	info.vFov = deviceProperties.v_fov;
+	info.range = deviceProperties.range;
+	return true;
+}
+
+UltraleapPoller::UltraleapPoller()
+{
+	registerBuiltInGestures();
+}
+
+UltraleapPoller::UltraleapPoller(const std::string& deviceSerial) :
+	deviceSerial_(deviceSerial)
+{
+	registerBuiltInGestures();
+}
+
+bool UltraleapPoller::openConnection()
+{
+	LEAP_CONNECTION_CONFIG config = {};
+	config.size = sizeof(config);
+	// Multi-device aware connections only hear from the devices they subscribe to
+	config.flags = deviceSerial_.empty() ? 0 : eLeapConnectionConfig_MultiDeviceAware;
+
+	eLeapRS res;
+	res = LeapCreateConnection(&config, &lc_);
+	if (res != eLeapRS_Success)
+	{
+		printf("Could not create connection. Failed with error: %s\n", errno_to_string(res));
+		lc_ = nullptr;
+		return false;
+	}
+
+	res = LeapOpenConnection(lc_);
+	if (res != eLeapRS_Success)
+	{
+		printf("Could not open connection. Failed with error: %s\n", errno_to_string(res));
+		LeapDestroyConnection(lc_);
+		lc_ = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+bool UltraleapPoller::connectWithRetry()
+{
+	uint32_t backoffMs = POLL_BACKOFF_MIN_MS;
+	while (pollerRunning_)
+	{
+		if (lc_ != nullptr || openConnection())
+		{
+			return true;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+		backoffMs = std::min(backoffMs * 2, static_cast<uint32_t>(POLL_BACKOFF_MAX_MS));
+	}
+	return false;
+}
+
+std::vector<std::string> UltraleapPoller::ListDeviceSerials(const uint32_t timeoutMs)
+{
+	std::vector<std::string> serials;
+
+	LEAP_CONNECTION connection;
+	if (LeapCreateConnection(nullptr, &connection) != eLeapRS_Success)
+	{
+		return serials;
+	}
+	if (LeapOpenConnection(connection) != eLeapRS_Success)
+	{
+		LeapDestroyConnection(connection);
+		return serials;
+	}
+
+	// Devices are announced once the connection is up. Stop early once they've gone quiet.
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	const auto quietTime = std::chrono::milliseconds(DEVICE_LIST_QUIET_MS);
+	auto lastDevice = std::chrono::steady_clock::now();
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		if (!serials.empty() && std::chrono::steady_clock::now() - lastDevice > quietTime)
+		{
+			break;
+		}
+
+		LEAP_CONNECTION_MESSAGE msg;
+		if (LeapPollConnection(connection, DEVICE_LIST_QUIET_MS, &msg) != eLeapRS_Success || msg.type != eLeapEventType_Device)
+		{
+			continue;
+		}
+
+		LEAP_DEVICE dev;
+		if (LeapOpenDevice(msg.device_event->device, &dev) != eLeapRS_Success)
+		{
+			continue;
+		}
+		UltraleapDeviceInfo info;
+		if (read_device_info(dev, info) && std::find(serials.begin(), serials.end(), info.serial) == serials.end())
+		{
+			serials.push_back(info.serial);
+			lastDevice = std::chrono::steady_clock::now();
+		}
+		LeapCloseDevice(dev);
+	}
+
+	LeapCloseConnection(connection);
+	LeapDestroyConnection(connection);
+	return serials;
+}
+
+const std::string& UltraleapPoller::GetDeviceSerial() const
+{
+	return deviceSerial_;
+}
+
+std::vector<UltraleapDeviceInfo> UltraleapPoller::GetDevices() const
+{
+	std::lock_guard<std::mutex> lock(devicesMutex_);
+	std::vector<UltraleapDeviceInfo> devices;
+	for (const auto& entry : devices_)
+	{
+		devices.push_back(entry.second);
+	}
+	return devices;
+}
+
+UltraleapPoller::~UltraleapPoller()
+{
+	StopPoller();
+	StopRecording();
+	if (device_ != nullptr)
+	{
+		LeapUnsubscribeEvents(lc_, device_);
+		closeSubscribedDevice();
+	}
+	if (lc_ != nullptr)
+	{
+		LeapCloseConnection(lc_);
+		LeapDestroyConnection(lc_);
+		lc_ = nullptr;
+	}	
+}
+
+bool UltraleapPoller::SetTrackingMode(const std::string& trackingMode)
+{
+	if (trackingMode == "desktop")
+	{
+		trackingMode_ = eLeapTrackingMode_Desktop;
+		trackingModeDirty_ = true;
+		return true;
+	}
+	else if (trackingMode == "screentop")
+	{
+		trackingMode_ = eLeapTrackingMode_ScreenTop;
+		trackingModeDirty_ = true;
+		return true;
+	}
+
+	return false;
+}
+
+void UltraleapPoller::SetIndexPinchThreshold(const float thresh)
+{
+	indexPinchThreshold_ = thresh;
+	// A negative threshold can never be met, and neither can a squared one of zero
+	indexPinchThresholdSq_ = thresh > 0.f ? thresh * thresh : 0.f;
+}
+
+GestureThresholds UltraleapPoller::GetGestureThresholds() const
+{
+	GestureThresholds thresholds;
+
+	// isAlmostPinch compares against a double. Against the largest float not above it a float
+	// comparison comes out the same.
+	double almostPinchLower = pinchThreshold_ - 0.15;
+	thresholds.almostPinchLower = static_cast<float>(almostPinchLower);
+	if (thresholds.almostPinchLower > almostPinchLower)
+	{
+		thresholds.almostPinchLower = std::nextafter(thresholds.almostPinchLower, -INFINITY);
+	}
+
+	thresholds.pinch = pinchThreshold_;
+	thresholds.indexPinchSq = indexPinchThresholdSq_;
+	thresholds.middlePinchSq = middlePinchThresholdSq_;
+	thresholds.ringPinchSq = ringPinchThresholdSq_;
+	thresholds.pinkyPinchSq = pinkyPinchThresholdSq_;
+	thresholds.fist = fistThreshold_;
+	thresholds.vCos = vThreshold_;
+	thresholds.rotationSq = rotationThresholdSq_;
+	thresholds.almostRotationSq = almostRotationThresholdSq_;
+	return thresholds;
+}
+
+bool UltraleapPoller::SetHandedness(const std::string& handedness)
+{
+	if (handedness != BOTH_HANDED &&
+	    handedness != LEFT_HANDED &&
+	    handedness != RIGHT_HANDED &&
+	    handedness != BIMANUAL_HANDED)
+	{
+		return false;
+	}
+
+	handedness_ = handedness;
+	bimanual_ = handedness == BIMANUAL_HANDED;
+	return true;
+}
+
+bool UltraleapPoller::SetPollStrategy(const std::string& strategy)
+{
+	if (strategy == POLL_STRATEGY_BUSY)
+	{
+		pollStrategy_ = UltraleapPollStrategy::Busy;
+		return true;
+	}
+	else if (strategy == POLL_STRATEGY_BLOCKING)
+	{
+		pollStrategy_ = UltraleapPollStrategy::Blocking;
+		return true;
+	}
+	else if (strategy == POLL_STRATEGY_HYBRID)
+	{
+		pollStrategy_ = UltraleapPollStrategy::Hybrid;
+		return true;
+	}
+
+	return false;
+}
+
+void UltraleapPoller::SetPollTimeout(const uint32_t timeoutMs)
+{
+	pollTimeoutMs_ = timeoutMs;
+}
+
+void UltraleapPoller::SetPollSpinTime(const uint32_t spinMicroseconds)
+{
+	pollSpinUs_ = spinMicroseconds;
+}
+
+void UltraleapPoller::SetSampleRate(const float rateHz)
+{
+	sampleRateHz_ = std::max(rateHz, 0.f);
+}
+
+UltraleapPollStats UltraleapPoller::GetPollStats() const
+{
+	UltraleapPollStats stats;
+	stats.strategy = pollStrategy_;
+	stats.polls = pollCounters_.polls;
+	stats.messages = pollCounters_.messages;
+	stats.timeouts = pollCounters_.timeouts;
+	stats.errors = pollCounters_.errors;
+	stats.wallSeconds = pollCounters_.wallSeconds;
+	stats.cpuSeconds = pollCounters_.cpuSeconds;
+	stats.wakeSamples = pollCounters_.wakeSamples;
+	stats.meanWakeLatencyUs = stats.wakeSamples ?
+		static_cast<double>(pollCounters_.wakeLatencySumUs) / static_cast<double>(stats.wakeSamples) : 0.0;
+	stats.maxWakeLatencyUs = pollCounters_.maxWakeLatencyUs;
+	stats.sampleRateHz = sampleRateHz_;
+	stats.samples = pollCounters_.samples;
+	stats.sampleFailures = pollCounters_.sampleFailures;
+	return stats;
+}
+
+void UltraleapPoller::PrintPollStats() const
+{
+	UltraleapPollStats stats = GetPollStats();
+	double cpuPercent = stats.wallSeconds > 0.0 ? 100.0 * stats.cpuSeconds / stats.wallSeconds : 0.0;
+
+	printf("Poll strategy: %s\n", poll_strategy_to_string(stats.strategy));
+	printf("  polls: %llu, messages: %llu, timeouts: %llu, errors: %llu\n",
+	       static_cast<unsigned long long>(stats.polls),
+	       static_cast<unsigned long long>(stats.messages),
+	       static_cast<unsigned long long>(stats.timeouts),
+	       static_cast<unsigned long long>(stats.errors));
+	printf("  polling thread CPU: %.3fs over %.3fs (%.1f%%)\n", stats.cpuSeconds, stats.wallSeconds, cpuPercent);
+	printf("  wake-up latency over %llu frames: mean %.1fus, max %lldus\n",
+	       static_cast<unsigned long long>(stats.wakeSamples),
+	       stats.meanWakeLatencyUs,
+	       static_cast<long long>(stats.maxWakeLatencyUs));
+	if (stats.sampleRateHz > 0.f)
+	{
+		printf("  sampling at %.1fHz: %llu frames interpolated, %llu failed\n",
+		       stats.sampleRateHz,
+		       static_cast<unsigned long long>(stats.samples),
+		       static_cast<unsigned long long>(stats.sampleFailures));
+	}
+	pollLatency_.Print("frame to poll return");
+	gestureLatency_.Print("poll return to gestures checked");
+	callbackLatency_.Print("gestures checked to frame end callback done");
+}
+
+UltraleapStartupStats UltraleapPoller::GetStartupStats() const
+{
+	UltraleapStartupStats stats;
+	stats.connectedUs = connectedUs_.load(std::memory_order_relaxed);
+	stats.firstFrameUs = firstFrameUs_.load(std::memory_order_relaxed);
+	return stats;
+}
+
+UltraleapFrameStats UltraleapPoller::GetFrameStats() const
+{
+	UltraleapFrameStats stats;
+	stats.processed = frameCounters_.processed;
+	stats.dropped = frameCounters_.dropped;
+	stats.untracked = frameCounters_.untracked;
+	stats.late = frameCounters_.late;
+	stats.outOfOrder = frameCounters_.outOfOrder;
+	stats.deviceFramerate = frameCounters_.deviceFramerate;
+	stats.effectiveFramerate = frameCounters_.effectiveFramerate;
+	return stats;
+}
+
+void UltraleapPoller::PrintFrameStats() const
+{
+	UltraleapFrameStats stats = GetFrameStats();
+	printf("Tracking frames: %llu processed, %llu dropped, %llu untracked, %llu late, %llu out of order\n",
+	       static_cast<unsigned long long>(stats.processed),
+	       static_cast<unsigned long long>(stats.dropped),
+	       static_cast<unsigned long long>(stats.untracked),
+	       static_cast<unsigned long long>(stats.late),
+	       static_cast<unsigned long long>(stats.outOfOrder));
+	printf("  framerate: %.1f handled of %.1f tracked\n", stats.effectiveFramerate, stats.deviceFramerate);
+}
+
+void UltraleapPoller::resetFrameCounters()
+{
+	frameCounters_.processed = 0;
+	frameCounters_.dropped = 0;
+	frameCounters_.untracked = 0;
+	frameCounters_.late = 0;
+	frameCounters_.outOfOrder = 0;
+	frameCounters_.deviceFramerate = 0.f;
+	frameCounters_.effectiveFramerate = 0.0;
+	haveLastFrame_ = false;
+	framerateWindowFrames_ = 0;
+}
+
+void UltraleapPoller::countFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs, const int64_t frameTimeUs)
+{
+	const int64_t trackingFrameId = tracking_event->tracking_frame_id;
+	const int64_t deviceFrameId = tracking_event->info.frame_id;
+	const int64_t timestamp = tracking_event->info.timestamp;
+
+	frameCounters_.processed++;
+	frameCounters_.deviceFramerate = tracking_event->framerate;
+
+	if (haveLastFrame_)
+	{
+		const int64_t trackingGap = trackingFrameId - lastTrackingFrameId_ - 1;
+		const int64_t deviceGap = deviceFrameId - lastDeviceFrameId_ - 1;
+		if (trackingGap < 0 || deviceGap < 0)
+		{
+			// Start again from here rather than guess what happened
+			frameCounters_.outOfOrder++;
+			framerateWindowFrames_ = 0;
+		}
+		else
+		{
+			frameCounters_.dropped += static_cast<uint64_t>(trackingGap);
+			if (deviceGap > trackingGap)
+			{
+				frameCounters_.untracked += static_cast<uint64_t>(deviceGap - trackingGap);
+			}
+		}
+	}
+	haveLastFrame_ = true;
+	lastTrackingFrameId_ = trackingFrameId;
+	lastDeviceFrameId_ = deviceFrameId;
+
+	// Late means the next frame was already due by the time we got this one
+	if (frameTimeUs != 0 && tracking_event->framerate > 0.f)
+	{
+		const int64_t periodUs = static_cast<int64_t>(1e6 / tracking_event->framerate);
+		if (receivedUs - frameTimeUs > periodUs)
+		{
+			frameCounters_.late++;
+		}
+	}
+
+	if (framerateWindowFrames_ == 0)
+	{
+		framerateWindowStartUs_ = timestamp;
+	}
+	framerateWindowFrames_++;
+	const int64_t windowUs = timestamp - framerateWindowStartUs_;
+	if (windowUs >= 1000000)
+	{
+		// Frames handled in the window, the first one only opens it
+		frameCounters_.effectiveFramerate = static_cast<double>(framerateWindowFrames_ - 1) * 1e6 / static_cast<double>(windowUs);
+		framerateWindowStartUs_ = timestamp;
+		framerateWindowFrames_ = 1;
+	}
+}
+
+int64_t UltraleapPoller::DeviceToHostTimeUs(const int64_t deviceTimestampUs) const
+{
+	if (!deviceClockSynced_.load(std::memory_order_acquire))
+	{
+		return 0;
+	}
+	return deviceTimestampUs - deviceClockOffsetUs_.load(std::memory_order_relaxed);
+}
+
+void UltraleapPoller::syncDeviceClock()
+{
+	// Bracket each LeapGetNow with host clock reads and trust the pair that was closest together
+	int64_t bestWidthUs = INT64_MAX;
+	int64_t bestOffsetUs = 0;
+	for (int i = 0; i < CLOCK_SYNC_SAMPLES; i++)
+	{
+		int64_t before = latency_clock_us();
+		int64_t device = LeapGetNow();
+		int64_t after = latency_clock_us();
+		if (after - before < bestWidthUs)
+		{
+			bestWidthUs = after - before;
+			bestOffsetUs = device - (before + after) / 2;
+		}
+	}
+
+	deviceClockOffsetUs_.store(bestOffsetUs, std::memory_order_relaxed);
+	deviceClockSynced_.store(true, std::memory_order_release);
+}
+
+bool UltraleapPoller::StartRecording(const std::string& path, const uint64_t capacityFrames)
+{
+	return recorder_.Open(path, capacityFrames);
+}
+
+void UltraleapPoller::StopRecording()
+{
+	recorder_.Close();
+}
+
+bool UltraleapPoller::ReplayRecording(const std::string& path, const bool realTime, UltraleapReplayStats* stats)
+{
+	FrameReplayer replayer;
+	if (!replayer.Open(path))
+	{
+		return false;
+	}
+
+	const uint64_t frames = replayer.FrameCount();
+	if (frames == 0)
+	{
+		printf("Recording %s is empty.\n", path.c_str());
+		return false;
+	}
+
+	// The virtual clock stands in for the device clock. Paced replays line it up with LeapGetNow
+	// so latencies still mean something, fast ones keep the recorded times so runs are repeatable.
+	const int64_t recordedStart = replayer.Frame(0).timestamp;
+	const int64_t clockStart = realTime ? LeapGetNow() : recordedStart;
+	resetFrameCounters();
+	if (realTime)
+	{
+		syncDeviceClock();
+	}
+	else
+	{
+		deviceClockSynced_ = false;
+	}
+	const auto wallStart = std::chrono::steady_clock::now();
+
+	LEAP_TRACKING_EVENT event;
+	event.info.reserved = nullptr;
+
+	for (uint64_t i = 0; i < frames; i++)
+	{
+		const FrameRecord& record = replayer.Frame(i);
+		const int64_t virtualNow = clockStart + (record.timestamp - recordedStart);
+
+		if (realTime)
+		{
+			int64_t waitUs = virtualNow - LeapGetNow();
+			if (waitUs > 0)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(waitUs));
+			}
+		}
+
+		event.info.frame_id = record.frameId;
+		event.info.timestamp = virtualNow;
+		event.tracking_frame_id = record.trackingFrameId;
+		event.nHands = record.nHands;
+		// Nothing downstream writes to the hands, so point straight into the read-only mapping
+		event.pHands = const_cast<LEAP_HAND*>(record.hands);
+		event.framerate = record.framerate;
+
+		handleTrackingMessage(&event, latency_clock_us());
+	}
+
+	double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	if (stats != nullptr)
+	{
+		stats->frames = frames;
+		stats->wallSeconds = wallSeconds;
+		stats->framesPerSecond = wallSeconds > 0.0 ? static_cast<double>(frames) / wallSeconds : 0.0;
+	}
+
+	return true;
+}
+
+void UltraleapPoller::StartPoller()
+{
+	startDeviceThread();
+	pollerRunning_ = true;
+    pollingThread_ = std::thread(&UltraleapPoller::runPoller, this);
+
+}
+
+void UltraleapPoller::StopPoller()
+{
+	if (pollerRunning_)
+	{
+		pollerRunning_ = false;
+		pollingThread_.join();
+	}
+	stopDeviceThread();
+}
+
+void UltraleapPoller::forwardDeviceEvent(const DeviceEventType type, const LEAP_DEVICE_REF& device)
+{
+	if (!deviceEvents_.TryPush(DeviceEvent{type, device}))
+	{
+		printf("Too many device events waiting, dropping one.\n");
+		return;
+	}
+
+	// Pairs with the fence in runDeviceThread(): either we see it asleep, or it sees the event
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (deviceThreadSleeping_.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> lock(deviceSleepMutex_);
+		deviceSleepCondition_.notify_one();
+	}
+}
+
+void UltraleapPoller::startDeviceThread()
+{
+	if (!deviceThreadRunning_)
+	{
+		deviceThreadRunning_ = true;
+		deviceThread_ = std::thread(&UltraleapPoller::runDeviceThread, this);
+	}
+}
+
+void UltraleapPoller::stopDeviceThread()
+{
+	if (deviceThreadRunning_)
+	{
+		{
+			std::lock_guard<std::mutex> lock(deviceSleepMutex_);
+			deviceThreadRunning_ = false;
+		}
+		deviceSleepCondition_.notify_one();
+		deviceThread_.join();
+	}
+}
+
+void UltraleapPoller::runDeviceThread()
+{
+	DeviceEvent event;
+	while (true)
+	{
+		while (deviceEvents_.TryPop(event))
+		{
+			switch (event.type)
+			{
+				case DeviceEventType::Found:
+					handleDeviceFound(event.device);
+					break;
+				case DeviceEventType::Lost:
+					handleDeviceLost(event.device);
+					break;
+				case DeviceEventType::ConnectionLost:
+					// The service forgets our subscription, it's redone when the device turns up again
+					closeSubscribedDevice();
+					{
+						std::lock_guard<std::mutex> lock(devicesMutex_);
+						devices_.clear();
+					}
+					break;
+			}
+		}
+
+		// Events forwarded before stopping have been handled by now
+		if (!deviceThreadRunning_)
+		{
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock(deviceSleepMutex_);
+		deviceThreadSleeping_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		deviceSleepCondition_.wait_for(lock, std::chrono::milliseconds(DEVICE_THREAD_SLEEP_MS), [this]()
+		{
+			return !deviceEvents_.Empty() || !deviceThreadRunning_;
+		});
+		deviceThreadSleeping_.store(false, std::memory_order_relaxed);
+	}
+}
+
+void UltraleapPoller::handleDeviceFound(const LEAP_DEVICE_REF& device)
+{
+	LEAP_DEVICE dev;
+	eLeapRS res = LeapOpenDevice(device, &dev);
+
+	if (res != eLeapRS_Success)
+	{
+		printf("Could not open device %s.\n", errno_to_string(res));
+		return;
+	}
+
+	UltraleapDeviceInfo info;
+	if (!read_device_info(dev, info))
+	{
+		LeapCloseDevice(dev);
+		return;
+	}
+	info.id = device.id;
+	{
+		std::lock_guard<std::mutex> lock(devicesMutex_);
+		devices_[device.id] = info;
+	}
+
+	if (deviceSerial_.empty())
+	{
+		printf("Device found: %s\n", info.serial.c_str());
+		LeapCloseDevice(dev);
+		return;
+	}
+
+	// Keep our own device open for as long as we're subscribed to it, and ignore the rest
+	if (info.serial != deviceSerial_ || device_ != nullptr)
+	{
+		LeapCloseDevice(dev);
+		return;
+	}
+
+	res = LeapSubscribeEvents(lc_, dev);
+	if (res != eLeapRS_Success)
+	{
+		printf("Could not subscribe to device %s: %s.\n", info.serial.c_str(), errno_to_string(res));
+		LeapCloseDevice(dev);
+		return;
+	}
+
+	printf("Device found: %s, subscribed\n", info.serial.c_str());
+	deviceId_ = device.id;
+	device_.store(dev, std::memory_order_release);
+	// Tracking mode is per device from here on, the polling thread sets it
+	trackingModeDirty_.store(true, std::memory_order_release);
+}
+
+void UltraleapPoller::handleDeviceLost(const LEAP_DEVICE_REF& device)
+{
+	std::string serial;
+	{
+		std::lock_guard<std::mutex> lock(devicesMutex_);
+		auto found = devices_.find(device.id);
+		if (found != devices_.end())
+		{
+			serial = found->second.serial;
+			devices_.erase(found);
+		}
+	}
+	printf("Device lost: %s\n", serial.empty() ? "unknown" : serial.c_str());
+
+	if (device_ != nullptr && deviceId_ == device.id)
+	{
+		closeSubscribedDevice();
+	}
+}
+
+void UltraleapPoller::closeSubscribedDevice()
+{
+	LEAP_DEVICE dev = device_.exchange(nullptr, std::memory_order_acq_rel);
+	if (dev != nullptr)
+	{
+		LeapCloseDevice(dev);
+	}
+	deviceId_ = 0;
+}
+
+void UltraleapPoller::handleTrackingMessage(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs)
+{
+	accountTrackingFrame(tracking_event, receivedUs);
+	dispatchTrackingFrame(tracking_event, receivedUs);
+}
+
+void UltraleapPoller::accountTrackingFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs)
+{
+  const int64_t frameTimeUs = DeviceToHostTimeUs(tracking_event->info.timestamp);
+  if (frameTimeUs != 0)
+  {
+		pollLatency_.Record(receivedUs - frameTimeUs);
+  }
+  countFrame(tracking_event, receivedUs, frameTimeUs);
+
+  recorder_.Record(tracking_event);
+}
+
+void UltraleapPoller::dispatchTrackingFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs)
+{
+  if (frameStartCallback_)
+  {
+		frameStartCallback_(tracking_event->info.timestamp);
+  }
+
+  if (tracking_event->nHands)
+  {
+		bool following = false;
+		for (const HandState& state : hands_)
+		{
+			following = following || state.handId != 0;
+		}
+
+		for (uint8_t h = 0; h < tracking_event->nHands; h++)
+		{
+			// Straight out of LeapC's buffer, it's too big to copy for every frame
+			const LEAP_HAND* hand = &tracking_event->pHands[h];
+			const UltraleapHandSide side = hand->type == eLeapHandType_Left ? HandSideLeft : HandSideRight;
+			HandState& state = hands_[side];
+			if (state.handId == hand->id)
+			{
+				(this->*handHandler_)(side, tracking_event->info.timestamp, hand);
+				continue;
+			}
+
+			// Take over a side whose hand has gone. Frames are handled from the next one on.
+			bool takeOver = false;
+			if (bimanual_)
+			{
+				takeOver = true;
+				for (uint8_t other = 0; other < tracking_event->nHands; other++)
+				{
+					takeOver = takeOver && tracking_event->pHands[other].id != state.handId;
+				}
+			}
+			else
+			{
+				takeOver = !following && handednessAllows(*hand);
+			}
+
+			if (takeOver)
+			{
+				state.handId = hand->id;
+				state.positionFilter.Reset();
+				following = true;
+			}
+		}
+  }
+  else // Can this happen?? A tracking message that just called to say hi?
+  {
+		for (HandState& state : hands_)
+		{
+			state.handId = 0;
+		}
+  }
+
+  const int64_t gesturesDoneUs = latency_clock_us();
+  gestureLatency_.Record(gesturesDoneUs - receivedUs);
+
+  if (frameEndCallback_)
+  {
+		frameEndCallback_(tracking_event->info.timestamp);
+		callbackLatency_.Record(latency_clock_us() - gesturesDoneUs);
+  }
+}
+
+bool UltraleapPoller::handednessAllows(const LEAP_HAND& hand) const
+{
+	return (handedness_ != LEFT_HANDED && hand.type != eLeapHandType_Left) ||
+	       (handedness_ != RIGHT_HANDED && hand.type != eLeapHandType_Right);
+}
+
+void UltraleapPoller::SetBounds(const UltraleapBounds& bounds)
+{
+	bounds_ = bounds;
+	boundsMm_.minX = -bounds.leftM * 1000.f;
+	boundsMm_.maxX = bounds.rightM * 1000.f;
+	boundsMm_.minY = -bounds.lowerM * 1000.f;
+	boundsMm_.maxY = bounds.upperM * 1000.f;
+	boundsMm_.minZ = -bounds.farM * 1000.f;
+	boundsMm_.maxZ = bounds.nearM * 1000.f;
+	selectHandHandler();
+}
+
+const UltraleapBounds& UltraleapPoller::GetBounds() const
+{
+	return bounds_;
+}
+
+void UltraleapPoller::selectHandHandler()
+{
+	if (bounds_.limitTrackingToWithinBounds)
+	{
+		handHandler_ = positionFilterActive_ ? &UltraleapPoller::handleHand<true, true> : &UltraleapPoller::handleHand<true, false>;
+	}
+	else
+	{
+		handHandler_ = positionFilterActive_ ? &UltraleapPoller::handleHand<false, true> : &UltraleapPoller::handleHand<false, false>;
+	}
+}
+
+template <bool LimitToBounds, bool FilterPosition>
+void UltraleapPoller::handleHand(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand)
+{
+	//printf("x=%f, y=%f, z=%f\n", hand->palm.position.x, hand->palm.position.y, hand->palm.position.z);
+	if (LimitToBounds)
+	{
+		const LEAP_VECTOR& p = hand->palm.position;
+		if (p.x < boundsMm_.minX || p.x > boundsMm_.maxX
+			|| p.y < boundsMm_.minY || p.y > boundsMm_.maxY
+			|| p.z < boundsMm_.minZ || p.z > boundsMm_.maxZ)
+		{
+			return;
+		}
+	}
+
+	// Do hand stuff.
+	HandState& state = hands_[side];
+	if (state.positionCallback)
+	{
+		if (FilterPosition)
+		{
+			state.positionCallback(state.positionFilter.Filter(hand->palm.position, timestamp));
+		}
+		else
+		{
+			state.positionCallback(hand->palm.position);
+		}
+	}
+
+	gestureChecks(side, timestamp, hand);
+}
+
+void UltraleapPoller::gestureChecks(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand)
+{
+	HandState& state = hands_[side];
+	if (state.gesturesTested == 0)
+	{
+		return;
+	}
+
+	HandFeatures features;
+	extractHandFeatures(hand, features);
+
+	// Gestures a fist doesn't affect go first, including the fist itself
+	testGestures(state, side, state.gesturesTested & ~gesturesSuppressedByFist_, timestamp, hand, features);
+	if (!(state.gesturesActive & (1ull << GestureFist)))
+	{
+		testGestures(state, side, state.gesturesTested & gesturesSuppressedByFist_, timestamp, hand, features);
+	}
+}
+
+void UltraleapPoller::testGestures(HandState& state, const UltraleapHandSide side, uint64_t gestures, const int64_t timestamp, const LEAP_HAND* hand, const HandFeatures& features)
+{
+	while (gestures)
+	{
+		const int id = lowest_set_bit(gestures);
+		const uint64_t bit = 1ull << id;
+		gestures &= gestures - 1;
+
+		GestureDetector& gesture = gestures_[id];
+		if (gesture.test(*hand, features))
+		{
+			if (state.gesturesActive & bit)
+			{
+				if (gesture.continueCallback[side])
+				{
+					gesture.continueCallback[side](timestamp, *hand);
+				}
+			}
+			else
+			{
+				if (gesture.startCallback[side])
+				{
+					gesture.startCallback[side](timestamp, *hand);
+				}
+				state.gesturesActive |= bit;
+			}
+		}
+		else
+		{
+			if (state.gesturesActive & bit)
+			{
+				if (gesture.stopCallback[side])
+				{
+					gesture.stopCallback[side](timestamp, *hand);
+				}
+				state.gesturesActive &= ~bit;
+			}
+		}
+	}
+}
+
+uint32_t UltraleapPoller::nextPollTimeout(const std::chrono::steady_clock::time_point& lastMessage) const
+{
+	switch (pollStrategy_)
+	{
+	case UltraleapPollStrategy::Busy:
+		return 0;
+	case UltraleapPollStrategy::Hybrid:
+		if (std::chrono::steady_clock::now() - lastMessage < std::chrono::microseconds(pollSpinUs_))
+		{
+			return 0;
+		}
+		return pollTimeoutMs_;
+	case UltraleapPollStrategy::Blocking:
+	default:
+		return pollTimeoutMs_;
 	}
 }
 
-UltraleapPoller::UltraleapPoller()
+void UltraleapPoller::updatePollCpuTime()
 {
-	eLeapRS res;
-    res = LeapCreateConnection(nullptr, &lc_);
-    if (res != eLeapRS_Success)
+	pollCounters_.cpuSeconds = thread_cpu_seconds() - pollThreadCpuStart_;
+	pollCounters_.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pollStartTime_).count();
+}
+
+void UltraleapPoller::runPoller()
+{
+	LEAP_CONNECTION_MESSAGE msg;
+	uint32_t backoffMs = 0;
+
+	if (!connectWithRetry())
+	{
+		return;
+	}
+
+	pollCounters_.polls = 0;
+	pollCounters_.messages = 0;
+	pollCounters_.timeouts = 0;
+	pollCounters_.errors = 0;
+	pollCounters_.wakeSamples = 0;
+	pollCounters_.wakeLatencySumUs = 0;
+	pollCounters_.maxWakeLatencyUs = 0;
+	pollCounters_.samples = 0;
+	pollCounters_.sampleFailures = 0;
+	resetFrameCounters();
+	pollLatency_.Reset();
+	gestureLatency_.Reset();
+	callbackLatency_.Reset();
+	pollStartTime_ = std::chrono::steady_clock::now();
+	pollThreadCpuStart_ = thread_cpu_seconds();
+	syncDeviceClock();
+
+	auto lastMessage = pollStartTime_;
+	auto lastCpuSample = pollStartTime_;
+
+	const bool sampling = sampleRateHz_ > 0.f;
+	const auto samplePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(sampling ? 1.0 / sampleRateHz_ : 0.0));
+	auto nextSample = pollStartTime_ + samplePeriod;
+	if (sampling)
 	{
-		printf("Could not create connection. Failed with error: %s", errno_to_string(res));
-		exit(EXIT_FAILURE);
+		const size_t bytes = sizeof(LEAP_TRACKING_EVENT) + SAMPLE_BUFFER_HANDS * sizeof(LEAP_HAND);
+		sampleBuffer_.resize((bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t));
 	}
 
-    res = LeapOpenConnection(lc_);
-    if (res != eLeapRS_Success)
+	while (pollerRunning_)
 	{
-		printf("Could not open connection. Failed with error: %s", errno_to_string(res));
-		exit(EXIT_FAILURE);
+		// As soon as the connection, or the device thread's subscription, makes it possible
+		if (trackingModeDirty_.load(std::memory_order_acquire))
+		{
+			applyTrackingMode();
+		}
+
+		uint32_t timeoutMs = nextPollTimeout(lastMessage);
+		if (sampling)
+		{
+			auto untilSample = nextSample - std::chrono::steady_clock::now();
+			if (untilSample < std::chrono::milliseconds(1))
+			{
+				// LeapPollConnection only waits whole milliseconds, so sleep out the rest
+				std::this_thread::sleep_until(nextSample);
+				sampleTrackingFrame();
+
+				// After a stall carry on from now, rather than catch up with a burst of samples
+				const auto sampled = std::chrono::steady_clock::now();
+				nextSample += samplePeriod;
+				if (nextSample < sampled)
+				{
+					nextSample = sampled + samplePeriod;
+				}
+				untilSample = nextSample - sampled;
+			}
+			timeoutMs = std::min(timeoutMs, static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(untilSample).count()));
+		}
+
+		eLeapRS res = LeapPollConnection(lc_, timeoutMs, &msg);
+		const int64_t receivedUs = latency_clock_us();
+		pollCounters_.polls++;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - lastCpuSample > std::chrono::milliseconds(POLL_CPU_SAMPLE_INTERVAL_MS))
+		{
+			updatePollCpuTime();
+			// Keep up with the two clocks drifting apart
+			syncDeviceClock();
+			lastCpuSample = now;
+		}
+
+		if (res == eLeapRS_Timeout)
+		{
+			// Nothing arrived in time, which is normal and not an error
+			pollCounters_.timeouts++;
+			continue;
+		}
+		else if (res != eLeapRS_Success)
+		{
+			pollCounters_.errors++;
+			if (backoffMs == 0)
+			{
+				printf("Polling failed with error: %s, backing off.\n", errno_to_string(res));
+				backoffMs = POLL_BACKOFF_MIN_MS;
+			}
+			else
+			{
+				backoffMs = std::min(backoffMs * 2, static_cast<uint32_t>(POLL_BACKOFF_MAX_MS));
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(backoffMs));
+			continue;
+		}
+
+		backoffMs = 0;
+		lastMessage = now;
+		pollCounters_.messages++;
+
+		if (msg.type == eLeapEventType_Tracking)
+		{
+			int64_t wakeLatencyUs = LeapGetNow() - msg.tracking_event->info.timestamp;
+			pollCounters_.wakeSamples++;
+			pollCounters_.wakeLatencySumUs += wakeLatencyUs;
+			if (wakeLatencyUs > pollCounters_.maxWakeLatencyUs)
+			{
+				pollCounters_.maxWakeLatencyUs = wakeLatencyUs;
+			}
+			if (firstFrameUs_.load(std::memory_order_relaxed) == 0)
+			{
+				firstFrameUs_.store(receivedUs, std::memory_order_relaxed);
+			}
+		}
+
+		switch (msg.type)
+		{
+			case eLeapEventType_Connection:
+				connected_ = true;
+				if (connectedUs_.load(std::memory_order_relaxed) == 0)
+				{
+					connectedUs_.store(receivedUs, std::memory_order_relaxed);
+				}
+				break;
+			case eLeapEventType_ConnectionLost:
+				printf("Lost the connection to the tracking service, waiting for it to come back.\n");
+				connected_ = false;
+				// The service forgets our mode and subscription, so both are redone once it's back
+				trackingModeDirty_ = true;
+				forwardDeviceEvent(DeviceEventType::ConnectionLost, LEAP_DEVICE_REF{});
+				break;
+			case eLeapEventType_TrackingMode:
+				// The service confirming applyTrackingMode, nothing to do
+				break;
+			case eLeapEventType_Device:
+				forwardDeviceEvent(DeviceEventType::Found, msg.device_event->device);
+				break;
+			case eLeapEventType_DeviceLost:
+				forwardDeviceEvent(DeviceEventType::Lost, msg.device_event->device);
+				break;
+			case eLeapEventType_Tracking:
+				if (sampling)
+				{
+					accountTrackingFrame(msg.tracking_event, receivedUs);
+				}
+				else
+				{
+					handleTrackingMessage(msg.tracking_event, receivedUs);
+				}
+				break;
+			default:
+			    printf("Received unsupported message\n");
+				break;
+		}
 	}
 
-	trackingMode_ = eLeapTrackingMode_Desktop;
+	updatePollCpuTime();
 }
 
-UltraleapPoller::~UltraleapPoller()
+void UltraleapPoller::sampleTrackingFrame()
 {
-	StopPoller();
-	if (lc_ != nullptr)
+	// A device of our own can't be asked about until we're subscribed to it
+	LEAP_DEVICE dev = device_.load(std::memory_order_acquire);
+	if (!connected_ || (!deviceSerial_.empty() && dev == nullptr))
 	{
-		LeapCloseConnection(lc_);
-		lc_ = nullptr;
-	}	
-}
+		return;
+	}
 
-bool UltraleapPoller::SetTrackingMode(const std::string& trackingMode)
-{
-	if (trackingMode == "desktop")
+	const int64_t timestamp = LeapGetNow();
+	const int64_t sampledUs = latency_clock_us();
+	LEAP_TRACKING_EVENT* event = nullptr;
+	uint64_t size = 0;
+	eLeapRS res = dev != nullptr ? LeapGetFrameSizeEx(lc_, dev, timestamp, &size) : LeapGetFrameSize(lc_, timestamp, &size);
+	if (res == eLeapRS_Success)
 	{
-		trackingMode_ = eLeapTrackingMode_Desktop;
-		trackingModeDirty_ = true;
-		return true;
+		if (size > sampleBuffer_.size() * sizeof(uint64_t))
+		{
+			sampleBuffer_.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+		}
+		event = reinterpret_cast<LEAP_TRACKING_EVENT*>(sampleBuffer_.data());
+		res = dev != nullptr ? LeapInterpolateTrackingFrameEx(lc_, dev, timestamp, event, size) : LeapInterpolateTrackingFrame(lc_, timestamp, event, size);
 	}
-	else if (trackingMode == "screentop")
+	if (res != eLeapRS_Success)
 	{
-		trackingMode_ = eLeapTrackingMode_ScreenTop;
-		trackingModeDirty_ = true;
-		return true;
+		pollCounters_.sampleFailures++;
+		return;
 	}
 
-	return false;
+	pollCounters_.samples++;
+	dispatchTrackingFrame(event, sampledUs);
 }
 
-void UltraleapPoller::SetIndexPinchThreshold(const float thresh)
+void UltraleapPoller::applyTrackingMode()
 {
-	indexPinchThreshold_ = thresh;
+	// A device of our own has to be subscribed to before its mode can be set
+	LEAP_DEVICE dev = device_.load(std::memory_order_acquire);
+	if (!connected_ || (!deviceSerial_.empty() && dev == nullptr))
+	{
+		return;
+	}
+
+	eLeapRS modeRes = dev != nullptr ? LeapSetTrackingModeEx(lc_, dev, trackingMode_) : LeapSetTrackingMode(lc_, trackingMode_);
+	if (eLeapRS_Success != modeRes)
+	{
+		printf("Failed to set tracking mode");
+	}
+
+	trackingModeDirty_ = false;
 }
 
-bool UltraleapPoller::SetHandedness(const std::string& handedness)
+void UltraleapPoller::SetPositionCallback(position_callback_t callback)
 {
-	if (handedness != BOTH_HANDED &&
-	    handedness != LEFT_HANDED &&
-	    handedness != RIGHT_HANDED)
+	for (HandState& state : hands_)
 	{
-		return false;
+		state.positionCallback = callback;
 	}
+}
 
-	handedness_ = handedness;
-	return true;
+void UltraleapPoller::ClearPositionCallback()
+{
+	SetPositionCallback(nullptr);
 }
 
-void UltraleapPoller::StartPoller()
+void UltraleapPoller::SetPositionCallback(const UltraleapHandSide side, position_callback_t callback)
 {
-	pollerRunning_ = true;
-    pollingThread_ = std::thread(&UltraleapPoller::runPoller, this);
+	hands_[side].positionCallback = callback;
+}
 
+void UltraleapPoller::ClearPositionCallback(const UltraleapHandSide side)
+{
+	SetPositionCallback(side, nullptr);
 }
 
-void UltraleapPoller::StopPoller()
+void UltraleapPoller::SetPositionFilter(const PositionFilterSettings& settings)
 {
-	if (pollerRunning_)
+	for (HandState& state : hands_)
 	{
-		pollerRunning_ = false;
-		pollingThread_.join();
+		state.positionFilter.SetSettings(settings);
 	}
+	positionFilterActive_ = true;
+	selectHandHandler();
 }
 
-void UltraleapPoller::handleDeviceMessage(const LEAP_DEVICE_EVENT* device_event)
+void UltraleapPoller::ClearPositionFilter()
 {
-	LEAP_DEVICE dev;
-	eLeapRS res = LeapOpenDevice(device_event->device, &dev);
+	positionFilterActive_ = false;
+	selectHandHandler();
+}
 
-	if (res != eLeapRS_Success)
+void UltraleapPoller::SetPredictionLeadTime(const float leadMs)
+{
+	for (HandState& state : hands_)
 	{
-		printf("Could not open device %s.\n", errno_to_string(res));
-		return;
+		state.positionFilter.SetLeadTime(leadMs);
 	}
+}
 
-	// Create a struct to hold the device properties, we have to provide a buffer for the serial string
-	LEAP_DEVICE_INFO deviceProperties = {sizeof(deviceProperties)};
-	// Start with a length of 1 (pretending we don't know a priori what the length is).
-	// Currently device serial numbers are all the same length, but that could change in the future
-	deviceProperties.serial_length = 1;
-	deviceProperties.serial = reinterpret_cast<char *>(malloc(deviceProperties.serial_length));
-	// This will fail since the serial buffer is only 1 character long
-	//  But deviceProperties is updated to contain the required buffer length
-	res = LeapGetDeviceInfo(dev, &deviceProperties);
-	if (res == eLeapRS_InsufficientBuffer)
+void UltraleapPoller::SetOnFrameStartCallback(frame_callback_t callback)
+{
+	frameStartCallback_ = callback;
+}
+
+void UltraleapPoller::SetOnFrameEndCallback(frame_callback_t callback)
+{
+	frameEndCallback_ = callback;
+}
+
+int UltraleapPoller::RegisterGesture(const std::string& name, gesture_test_t test, const uint32_t flags)
+{
+	if (!test || gestures_.size() >= MAX_GESTURES || FindGesture(name) >= 0)
 	{
-		// try again with correct buffer size
-		deviceProperties.serial = reinterpret_cast<char *>(realloc(deviceProperties.serial, deviceProperties.serial_length));
-		res = LeapGetDeviceInfo(dev, &deviceProperties);
-		if (res != eLeapRS_Success)
+		return -1;
+	}
+
+	GestureDetector gesture;
+	gesture.name = name;
+	gesture.test = test;
+	gesture.flags = flags;
+	gestures_.push_back(gesture);
+
+	const int id = static_cast<int>(gestures_.size() - 1);
+	if (flags & GESTURE_FLAG_SUPPRESSED_BY_FIST)
+	{
+		gesturesSuppressedByFist_ |= 1ull << id;
+	}
+	return id;
+}
+
+int UltraleapPoller::FindGesture(const std::string& name) const
+{
+	for (size_t id = 0; id < gestures_.size(); id++)
+	{
+		if (gestures_[id].name == name)
 		{
-			printf("Failed to get device info %s.\n", errno_to_string(res));
-			free(deviceProperties.serial);
-			return;
+			return static_cast<int>(id);
 		}
 	}
-	printf("Device found: %s", deviceProperties.serial);
+	return -1;
+}
 
-  free(deviceProperties.serial);
-  LeapCloseDevice(dev);
+void UltraleapPoller::ExtractHandFeatures(const LEAP_HAND* hand, HandFeatures& features) const
+{
+	extractHandFeatures(hand, features);
 }
 
-void UltraleapPoller::handleTrackingMessage(const LEAP_TRACKING_EVENT* tracking_event)
+bool UltraleapPoller::TestGesture(const int gesture, const LEAP_HAND& hand, const HandFeatures& features) const
 {
-  if (tracking_event->nHands)
-  {
-		for (uint8_t h = 0; h < tracking_event->nHands; h++)
-		{
-			LEAP_HAND hand = tracking_event->pHands[h];
-			if (activeHandID != 0)
-			{
-				if (hand.id != activeHandID)
-				{
-					continue;
-				}
-				else
-				{
-					//printf("x=%f, y=%f, z=%f\n", hand.palm.position.x, hand.palm.position.y, hand.palm.position.z);
-					if (bounds.limitTrackingToWithinBounds)
-					{
-						if (hand.palm.position.x * 0.001f < -bounds.leftM || hand.palm.position.x * 0.001f > bounds.rightM
-							|| hand.palm.position.y * 0.001f < -bounds.lowerM || hand.palm.position.y * 0.001f > bounds.upperM
-							|| hand.palm.position.z * 0.001f > bounds.nearM || hand.palm.position.z * 0.001f < -bounds.farM)
-						{
-							continue;
-						}
-					}
+	if (gesture < 0 || gesture >= static_cast<int>(gestures_.size()))
+	{
+		return false;
+	}
+	return gestures_[gesture].test(hand, features);
+}
 
-					// Do hand stuff.
-					if (positionCallback_)
-					{
-						positionCallback_(hand.palm.position);
-					}
-					
-					int64_t timestamp = tracking_event->info.timestamp;
+void UltraleapPoller::CheckGestures(const UltraleapHandSide side, const int64_t timestamp, const LEAP_HAND* hand)
+{
+	gestureChecks(side, timestamp, hand);
+}
 
-					// The following need to be added manually, the macro can't do it
-					AlmostPinchChecks(timestamp, &hand);
-					FistChecks(timestamp, &hand);
-					if (!doingFist_) // A fist is also detected as a pinch, but not the other way round
-					{
-					    PinchChecks(timestamp, &hand);
-						IndexPinchChecks(timestamp, &hand);
-						MiddlePinchChecks(timestamp, &hand);
-						RingPinchChecks(timestamp, &hand);
-						PinkyPinchChecks(timestamp, &hand);
-						VChecks(timestamp, &hand);
-						AlmostRotateChecks(timestamp, &hand);
-						RotateChecks(timestamp, &hand);
-					}
-				}
-			}
-			else
-			{
-				if ((handedness_ != LEFT_HANDED && hand.type != eLeapHandType_Left) ||
-				    (handedness_ != RIGHT_HANDED && hand.type != eLeapHandType_Right))
-				{
-					activeHandID = hand.id;
-				}
-			}
-		}
-  }
-  else // Can this happen?? A tracking message that just called to say hi?
-  {
-		activeHandID = 0;
-  }
+void UltraleapPoller::HandleTrackingFrame(const LEAP_TRACKING_EVENT* tracking_event, const int64_t receivedUs)
+{
+	handleTrackingMessage(tracking_event, receivedUs);
 }
 
-void UltraleapPoller::runPoller()
+// Stands for both sides in setGestureCallback
+#define BOTH_SIDES -1
+
+bool UltraleapPoller::SetOnGestureStartCallback(const int gesture, gesture_callback_t callback)
 {
-	LEAP_CONNECTION_MESSAGE msg;
-	
-	while (pollerRunning_)
+	return setGestureCallback(gesture, &GestureDetector::startCallback, BOTH_SIDES, callback);
+}
+
+bool UltraleapPoller::SetOnGestureContinueCallback(const int gesture, gesture_callback_t callback)
+{
+	return setGestureCallback(gesture, &GestureDetector::continueCallback, BOTH_SIDES, callback);
+}
+
+bool UltraleapPoller::SetOnGestureStopCallback(const int gesture, gesture_callback_t callback)
+{
+	return setGestureCallback(gesture, &GestureDetector::stopCallback, BOTH_SIDES, callback);
+}
+
+bool UltraleapPoller::SetOnGestureStartCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback)
+{
+	return setGestureCallback(gesture, &GestureDetector::startCallback, side, callback);
+}
+
+bool UltraleapPoller::SetOnGestureContinueCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback)
+{
+	return setGestureCallback(gesture, &GestureDetector::continueCallback, side, callback);
+}
+
+bool UltraleapPoller::SetOnGestureStopCallback(const UltraleapHandSide side, const int gesture, gesture_callback_t callback)
+{
+	return setGestureCallback(gesture, &GestureDetector::stopCallback, side, callback);
+}
+
+void UltraleapPoller::ClearGestureCallbacks(const UltraleapHandSide side)
+{
+	for (GestureDetector& gesture : gestures_)
 	{
-	    if (eLeapRS_Success != LeapPollConnection(lc_, 0, &msg))
+		gesture.startCallback[side] = nullptr;
+		gesture.continueCallback[side] = nullptr;
+		gesture.stopCallback[side] = nullptr;
+	}
+	updateTestedGestures();
+}
+
+bool UltraleapPoller::setGestureCallback(const int gesture, side_callbacks_t GestureDetector::*slot, const int side, gesture_callback_t callback)
+{
+	if (gesture < 0 || gesture >= static_cast<int>(gestures_.size()))
+	{
+		return false;
+	}
+
+	for (int s = 0; s < HandSideCount; s++)
+	{
+		if (side == BOTH_SIDES || side == s)
 		{
-            continue;
-		}	
+			(gestures_[gesture].*slot)[s] = callback;
+		}
+	}
+	updateTestedGestures();
+	return true;
+}
 
-		if (trackingModeDirty_)
+void UltraleapPoller::updateTestedGestures()
+{
+	for (int side = 0; side < HandSideCount; side++)
+	{
+		uint64_t tested = 0;
+		for (size_t id = 0; id < gestures_.size(); id++)
 		{
-			if (eLeapRS_Success != LeapSetTrackingMode(lc_, trackingMode_))
+			const GestureDetector& gesture = gestures_[id];
+			if (gesture.startCallback[side] || gesture.continueCallback[side] || gesture.stopCallback[side])
 			{
-				printf("Failed to set tracking mode");
+				tested |= 1ull << id;
 			}
-
-			trackingModeDirty_ = false;
 		}
-		
-		switch (msg.type)
+
+		// Whether a fist is being made decides whether these are tested at all
+		if (tested & gesturesSuppressedByFist_)
 		{
-			case eLeapEventType_Device:
-				handleDeviceMessage(msg.device_event);
-				break;
-			case eLeapEventType_Tracking:
-				handleTrackingMessage(msg.tracking_event);
-				break;
-			default:
-			    printf("Received unsupported message\n");
-				break;
+			tested |= 1ull << GestureFist;
 		}
+
+		// Anything no longer tested can't be carrying on
+		hands_[side].gesturesActive &= tested;
+		hands_[side].gesturesTested = tested;
 	}
 }
 
-void UltraleapPoller::SetPositionCallback(position_callback_t callback)
+// Registers the built-in gestures in UltraleapGesture order
+#define RegisterBuiltInGesture(name, flags) \
+	if (RegisterGesture(#name, gesture_test_t(&builtInGestureTest<&UltraleapPoller::is##name>, this), flags) != Gesture##name) \
+	{ \
+		printf("Built-in gesture " #name " registered out of order.\n"); \
+	}
+
+void UltraleapPoller::registerBuiltInGestures()
 {
-	positionCallback_ = callback;
+	RegisterBuiltInGesture(AlmostPinch, 0);
+	RegisterBuiltInGesture(Pinch, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(IndexPinch, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(MiddlePinch, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(RingPinch, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(PinkyPinch, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(Fist, 0);
+	RegisterBuiltInGesture(V, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(AlmostRotate, GESTURE_FLAG_SUPPRESSED_BY_FIST);
+	RegisterBuiltInGesture(Rotate, GESTURE_FLAG_SUPPRESSED_BY_FIST);
 }
 
 #define AddGestureCallbackSettersDefinition(name) \
 void UltraleapPoller::SetOn##name##StartCallback(gesture_callback_t callback) \
 { \
-	name##StartCallback_ = callback; \
+	SetOnGestureStartCallback(Gesture##name, callback); \
 } \
 void UltraleapPoller::SetOn##name##ContinueCallback(gesture_callback_t callback) \
 { \
-	name##ContinueCallback_ = callback; \
+	SetOnGestureContinueCallback(Gesture##name, callback); \
 } \
 void UltraleapPoller::SetOn##name##StopCallback(gesture_callback_t callback) \
 { \
-	name##StopCallback_ = callback; \
+	SetOnGestureStopCallback(Gesture##name, callback); \
+} \
+void UltraleapPoller::SetOn##name##StartCallback(const UltraleapHandSide side, gesture_callback_t callback) \
+{ \
+	SetOnGestureStartCallback(side, Gesture##name, callback); \
+} \
+void UltraleapPoller::SetOn##name##ContinueCallback(const UltraleapHandSide side, gesture_callback_t callback) \
+{ \
+	SetOnGestureContinueCallback(side, Gesture##name, callback); \
+} \
+void UltraleapPoller::SetOn##name##StopCallback(const UltraleapHandSide side, gesture_callback_t callback) \
+{ \
+	SetOnGestureStopCallback(side, Gesture##name, callback); \
 } \
 void UltraleapPoller::ClearOn##name##StartCallback() \
 { \
-	name##StartCallback_ = nullptr; \
+	SetOnGestureStartCallback(Gesture##name, nullptr); \
 } \
 void UltraleapPoller::ClearOn##name##ContinueCallback() \
 { \
-	name##ContinueCallback_ = nullptr; \
+	SetOnGestureContinueCallback(Gesture##name, nullptr); \
 } \
 void UltraleapPoller::ClearOn##name##StopCallback() \
 { \
-	name##StopCallback_ = nullptr; \
-} \
-void UltraleapPoller::name##Checks(const int64_t timestamp, const LEAP_HAND* hand) \
-{ \
-  if (is##name(hand)) \
-  { \
-		if (doing##name##_) \
-		{ \
-			if (name##ContinueCallback_) \
-			{ \
-				name##ContinueCallback_(timestamp, *hand); \
-			} \
-		} \
-		else \
-		{ \
-			if (name##StartCallback_) \
-			{ \
-				name##StartCallback_(timestamp, *hand); \
-			} \
-			doing##name##_ = true; \
-		} \
-  } \
-  else \
-  { \
-		if (doing##name##_) \
-		{ \
-			if (name##StopCallback_) \
-			{ \
-				name##StopCallback_(timestamp, *hand); \
-			} \
-			doing##name##_ = false; \
-		} \
-  } \
+	SetOnGestureStopCallback(Gesture##name, nullptr); \
 }
 
-
 AddGestureCallbackSettersDefinition(AlmostPinch);
 AddGestureCallbackSettersDefinition(Pinch);
 AddGestureCallbackSettersDefinition(IndexPinch);
@@ -374,61 +1609,83 @@ float UltraleapPoller::dot(const LEAP_VECTOR first, const LEAP_VECTOR second) co
 	       (first.z * second.z);
 }
 
-float UltraleapPoller::magnitude(const LEAP_VECTOR vec) const
+float UltraleapPoller::distanceSquared(const LEAP_VECTOR first, const LEAP_VECTOR second) const
+{
+	LEAP_VECTOR diff = difference(second, first);
+	return dot(diff, diff);
+}
+
+void UltraleapPoller::extractHandFeatures(const LEAP_HAND* hand, HandFeatures& features) const
 {
-	return std::sqrt(
-		(vec.x * vec.x) +
-		(vec.y * vec.y) +
-		(vec.z * vec.z));
+	const LEAP_VECTOR& thumbTip = hand->thumb.distal.next_joint;
+	features.thumbTipDistanceSq[TIP_INDEX]  = distanceSquared(hand->index.distal.next_joint, thumbTip);
+	features.thumbTipDistanceSq[TIP_MIDDLE] = distanceSquared(hand->middle.distal.next_joint, thumbTip);
+	features.thumbTipDistanceSq[TIP_RING]   = distanceSquared(hand->ring.distal.next_joint, thumbTip);
+	features.thumbTipDistanceSq[TIP_PINKY]  = distanceSquared(hand->pinky.distal.next_joint, thumbTip);
+
+	features.pinchStrength = hand->pinch_strength;
+	features.grabStrength = hand->grab_strength;
+
+	float spreadX = hand->index.proximal.prev_joint.x - hand->pinky.proximal.prev_joint.x;
+	float spreadZ = hand->index.proximal.prev_joint.z - hand->pinky.proximal.prev_joint.z;
+	features.knuckleSpreadSq = spreadX * spreadX + spreadZ * spreadZ;
+
+	LEAP_VECTOR index_vec  = difference(hand->index.distal.next_joint, hand->index.distal.prev_joint);
+	LEAP_VECTOR middle_vec = difference(hand->middle.distal.next_joint, hand->middle.distal.prev_joint);
+	LEAP_VECTOR pinky_vec  = difference(hand->pinky.distal.next_joint, hand->pinky.distal.prev_joint);
+
+	// One square root for both lengths. Zero-length bones give NaN, which fails every comparison.
+	features.indexMiddleCos = dot(index_vec, middle_vec) / std::sqrt(dot(index_vec, index_vec) * dot(middle_vec, middle_vec));
+	features.indexPinkyDot = dot(index_vec, pinky_vec);
 }
 
 // The following gesture tests need to be added manually and match names given to the macro above
-bool UltraleapPoller::isAlmostPinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isAlmostPinch(const HandFeatures& features) const
 {
-	return hand->pinch_strength < pinchThreshold_ && hand->pinch_strength > (pinchThreshold_ - 0.15);
+	return features.pinchStrength < pinchThreshold_ && features.pinchStrength > (pinchThreshold_ - 0.15);
 }
 
-bool UltraleapPoller::isPinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isPinch(const HandFeatures& features) const
 {
-	return hand->pinch_strength > pinchThreshold_;
+	return features.pinchStrength > pinchThreshold_;
 }
 
-bool UltraleapPoller::isIndexPinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isIndexPinch(const HandFeatures& features) const
 {
-	return distance(hand->index.distal.next_joint, hand->thumb.distal.next_joint)  < indexPinchThreshold_ &&
-	       distance(hand->middle.distal.next_joint, hand->thumb.distal.next_joint) > indexPinchThreshold_ &&
-	       distance(hand->ring.distal.next_joint, hand->thumb.distal.next_joint)   > indexPinchThreshold_ &&
-	       distance(hand->pinky.distal.next_joint, hand->thumb.distal.next_joint)  > indexPinchThreshold_;
+	return features.thumbTipDistanceSq[TIP_INDEX]  < indexPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_MIDDLE] > indexPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_RING]   > indexPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_PINKY]  > indexPinchThresholdSq_;
 }
 
 
-bool UltraleapPoller::isMiddlePinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isMiddlePinch(const HandFeatures& features) const
 {
-	return distance(hand->index.distal.next_joint, hand->thumb.distal.next_joint)  > middlePinchThreshold_ &&
-	       distance(hand->middle.distal.next_joint, hand->thumb.distal.next_joint) < middlePinchThreshold_ &&
-	       distance(hand->ring.distal.next_joint, hand->thumb.distal.next_joint)   > middlePinchThreshold_ &&
-	       distance(hand->pinky.distal.next_joint, hand->thumb.distal.next_joint)  > middlePinchThreshold_;
+	return features.thumbTipDistanceSq[TIP_INDEX]  > middlePinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_MIDDLE] < middlePinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_RING]   > middlePinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_PINKY]  > middlePinchThresholdSq_;
 }
 
-bool UltraleapPoller::isRingPinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isRingPinch(const HandFeatures& features) const
 {
-	return distance(hand->index.distal.next_joint, hand->thumb.distal.next_joint)  > ringPinchThreshold_ &&
-	       distance(hand->middle.distal.next_joint, hand->thumb.distal.next_joint) > ringPinchThreshold_ &&
-	       distance(hand->ring.distal.next_joint, hand->thumb.distal.next_joint)   < ringPinchThreshold_ &&
-	       distance(hand->pinky.distal.next_joint, hand->thumb.distal.next_joint)  > ringPinchThreshold_;
+	return features.thumbTipDistanceSq[TIP_INDEX]  > ringPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_MIDDLE] > ringPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_RING]   < ringPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_PINKY]  > ringPinchThresholdSq_;
 }
 
-bool UltraleapPoller::isPinkyPinch(const LEAP_HAND* hand) const
+bool UltraleapPoller::isPinkyPinch(const HandFeatures& features) const
 {
-	return distance(hand->index.distal.next_joint, hand->thumb.distal.next_joint)  > pinkyPinchThreshold_ &&
-	       distance(hand->middle.distal.next_joint, hand->thumb.distal.next_joint) > pinkyPinchThreshold_ &&
-	       distance(hand->ring.distal.next_joint, hand->thumb.distal.next_joint)   > pinkyPinchThreshold_ &&
-	       distance(hand->pinky.distal.next_joint, hand->thumb.distal.next_joint)  < pinkyPinchThreshold_;
+	return features.thumbTipDistanceSq[TIP_INDEX]  > pinkyPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_MIDDLE] > pinkyPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_RING]   > pinkyPinchThresholdSq_ &&
+	       features.thumbTipDistanceSq[TIP_PINKY]  < pinkyPinchThresholdSq_;
 }
 
-bool UltraleapPoller::isFist(const LEAP_HAND* hand) const
+bool UltraleapPoller::isFist(const HandFeatures& features) const
 {
-	return hand->grab_strength > fistThreshold_;
+	return features.grabStrength > fistThreshold_;
 }
 
 // bool UltraleapPoller::isV(const LEAP_HAND* hand) const
@@ -439,33 +1696,19 @@ bool UltraleapPoller::isFist(const LEAP_HAND* hand) const
 //             distance(hand->pinky.distal.next_joint, hand->palm.position)  < 40.f;
 // }
 
-bool UltraleapPoller::isV(const LEAP_HAND* hand) const
+bool UltraleapPoller::isV(const HandFeatures& features) const
 {
-     LEAP_VECTOR index_vec  = difference(hand->index.distal.next_joint, hand->index.distal.prev_joint);
-     LEAP_VECTOR middle_vec = difference(hand->middle.distal.next_joint, hand->middle.distal.prev_joint);
-     // LEAP_VECTOR ring_vec   = difference(hand->ring.distal.next_joint, hand->ring.distal.prev_joint);
-     LEAP_VECTOR pinky_vec  = difference(hand->pinky.distal.next_joint, hand->pinky.distal.prev_joint);
-
-	 float index_middle_cos = dot(index_vec, middle_vec) / (magnitude(index_vec) * magnitude(middle_vec));
-	 // float ring_pinky_cos = dot(ring_vec, pinky_vec) / (magnitude(ring_vec) * magnitude(pinky_vec));
-	 float index_pinky_cos = dot(index_vec, pinky_vec) / (magnitude(index_vec) * magnitude(pinky_vec));
-
-     float thresh = 0.6f;
-	 return index_middle_cos >  thresh &&
-	        // ring_pinky_cos   >  thresh &&
-	        index_pinky_cos  < 0;
+	 // The index and pinky cosine is negative exactly when their dot product is
+	 return features.indexMiddleCos > vThreshold_ &&
+	        features.indexPinkyDot  < 0;
 }
 
-bool UltraleapPoller::isAlmostRotate(const LEAP_HAND* hand) const
+bool UltraleapPoller::isAlmostRotate(const HandFeatures& features) const
 {
-     double angle = std::sqrt(std::pow(hand->index.proximal.prev_joint.x - hand->pinky.proximal.prev_joint.x, 2) +
-                      std::pow(hand->index.proximal.prev_joint.z - hand->pinky.proximal.prev_joint.z, 2));
-     return angle > rotationThreshold_ && angle < rotationThreshold_ + 20.0;
+     return features.knuckleSpreadSq > rotationThresholdSq_ && features.knuckleSpreadSq < almostRotationThresholdSq_;
 }
 
-bool UltraleapPoller::isRotate(const LEAP_HAND* hand) const
+bool UltraleapPoller::isRotate(const HandFeatures& features) const
 {
-     return std::sqrt(std::pow(hand->index.proximal.prev_joint.x - hand->pinky.proximal.prev_joint.x, 2) +
-                      std::pow(hand->index.proximal.prev_joint.z - hand->pinky.proximal.prev_joint.z, 2)) < rotationThreshold_;
+     return features.knuckleSpreadSq < rotationThresholdSq_;
 }
-